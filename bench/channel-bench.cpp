@@ -0,0 +1,243 @@
+#include "../ratatoskr/concurrent.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+template <std::size_t N>
+struct payload {
+  std::array<std::byte, N> data;
+
+  payload() : data{} {}
+  explicit payload(std::size_t i) : data{} {
+    data[0] = static_cast<std::byte>(i);
+  }
+};
+
+template <class T>
+T make_value(std::size_t i) {
+  if constexpr (std::is_arithmetic_v<T>) {
+    return static_cast<T>(i);
+  }
+  else {
+    return T{i};
+  }
+}
+
+void report_throughput(const std::string &name, std::size_t n,
+                       clock_type::duration elapsed) {
+  auto sec = std::chrono::duration<double>(elapsed).count();
+  std::cout << std::left << std::setw(48) << name << std::right << std::fixed
+            << std::setprecision(2) << std::setw(10) << n / sec / 1e6
+            << " Mmsg/s" << std::setw(10) << sec * 1e9 / n << " ns/msg"
+            << std::endl;
+}
+
+template <class T, class Sender, class Receiver>
+void run_throughput(const std::string &name, Sender sn, Receiver rc,
+                    std::size_t producers, std::size_t consumers,
+                    std::size_t n) {
+  std::vector<std::thread> threads;
+  std::atomic<std::size_t> received{0};
+  auto per_producer = n / producers;
+  auto total = per_producer * producers;
+  auto start = clock_type::now();
+  for (std::size_t c = 0; c < consumers; ++c) {
+    threads.emplace_back([&received, total, rc = rc]() mutable {
+      try {
+        while (received.fetch_add(1, std::memory_order_relaxed) < total) {
+          rc.next();
+        }
+      }
+      catch (const rat::close_channel &) {
+      }
+    });
+  }
+  std::vector<std::thread> senders;
+  for (std::size_t p = 0; p + 1 < producers; ++p) {
+    senders.emplace_back([per_producer, sn = sn]() mutable {
+      for (std::size_t i = 0; i < per_producer; ++i) {
+        sn.push(make_value<T>(i));
+      }
+    });
+  }
+  for (std::size_t i = 0; i < per_producer; ++i) {
+    sn.push(make_value<T>(i));
+  }
+  for (auto &&th : senders) {
+    th.join();
+  }
+  for (auto &&th : threads) {
+    th.join();
+  }
+  auto elapsed = clock_type::now() - start;
+  sn.close();
+  report_throughput(name, total, elapsed);
+}
+
+template <class T, class Sender, class Receiver>
+void run_spsc(const std::string &name, Sender sn, Receiver rc, std::size_t n) {
+  auto start = clock_type::now();
+  std::thread producer{[n, sn = std::move(sn)]() mutable {
+    for (std::size_t i = 0; i < n; ++i) {
+      sn.push(make_value<T>(i));
+    }
+  }};
+  for (std::size_t i = 0; i < n; ++i) {
+    rc.next();
+  }
+  auto elapsed = clock_type::now() - start;
+  producer.join();
+  report_throughput(name, n, elapsed);
+}
+
+void batch(std::size_t n, std::size_t batch_size) {
+  {
+    auto [sn, rc] = rat::make_channel<int>(4096);
+    auto start = clock_type::now();
+    std::thread producer{[n, sn = std::move(sn)]() mutable {
+      for (std::size_t i = 0; i < n; ++i) {
+        sn.push(static_cast<int>(i));
+      }
+    }};
+    for (std::size_t i = 0; i < n; ++i) {
+      rc.next();
+    }
+    auto elapsed = clock_type::now() - start;
+    producer.join();
+    report_throughput("bounded per-element push/next", n, elapsed);
+  }
+  {
+    auto [sn, rc] = rat::make_channel<int>(4096);
+    auto start = clock_type::now();
+    std::thread producer{[n, batch_size, sn = std::move(sn)]() mutable {
+      std::vector<int> values(batch_size);
+      for (std::size_t i = 0; i < n; i += batch_size) {
+        std::iota(values.begin(), values.end(), static_cast<int>(i));
+        sn.push_bulk(values);
+      }
+    }};
+    std::vector<int> out(batch_size);
+    for (std::size_t i = 0; i < n;) {
+      i += rc.next_n(out.begin(), batch_size);
+    }
+    auto elapsed = clock_type::now() - start;
+    producer.join();
+    report_throughput("bounded push_bulk/next_n x" + std::to_string(batch_size),
+                      n, elapsed);
+  }
+}
+
+template <class Factory>
+void ping_pong(const std::string &name, Factory make, std::size_t n,
+               std::size_t spin = 0) {
+  auto [ping_sn, ping_rc] = make();
+  auto [pong_sn, pong_rc] = make();
+  ping_rc.set_spin_count(spin);
+  pong_rc.set_spin_count(spin);
+  std::thread echo{[rc = std::move(ping_rc), sn = std::move(pong_sn)]() mutable {
+    try {
+      while (true) {
+        sn.push(rc.next());
+      }
+    }
+    catch (const rat::close_channel &) {
+    }
+  }};
+  std::vector<clock_type::duration> samples;
+  samples.reserve(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    auto start = clock_type::now();
+    ping_sn.push(static_cast<int>(i));
+    pong_rc.next();
+    samples.push_back(clock_type::now() - start);
+  }
+  ping_sn.close();
+  echo.join();
+  std::sort(samples.begin(), samples.end());
+  auto percentile = [&samples](double p) {
+    auto i = static_cast<std::size_t>(p * (samples.size() - 1));
+    return std::chrono::duration<double, std::nano>(samples[i]).count();
+  };
+  std::cout << std::left << std::setw(48) << name << std::right << std::fixed
+            << std::setprecision(0) << " p50 " << percentile(0.5) << " ns"
+            << "  p90 " << percentile(0.9) << " ns"
+            << "  p99 " << percentile(0.99) << " ns"
+            << "  p99.9 " << percentile(0.999) << " ns" << std::endl;
+}
+
+template <class T>
+void spsc_payload(const std::string &name, std::size_t n) {
+  {
+    auto [sn, rc] = rat::make_channel<T>();
+    run_spsc<T>("unbounded mutex    " + name, std::move(sn), std::move(rc), n);
+  }
+  {
+    auto [sn, rc] = rat::make_channel<T>(1024);
+    run_spsc<T>("bounded mutex      " + name, std::move(sn), std::move(rc), n);
+  }
+  {
+    auto [sn, rc] = rat::make_channel<T>(rat::with_single_sender, 1024);
+    run_spsc<T>("spsc lock-free     " + name, std::move(sn), std::move(rc), n);
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::size_t n = argc > 1 ? std::stoul(argv[1]) : 1000000;
+
+  std::cout << "# SPSC throughput by payload size" << std::endl;
+  spsc_payload<int>("int", n);
+  spsc_payload<payload<64>>("64 B", n);
+  spsc_payload<payload<512>>("512 B", n / 4);
+  spsc_payload<payload<4096>>("4 KiB", n / 16);
+
+  std::cout << "# MPSC throughput (4 producers, 1 receiver)" << std::endl;
+  {
+    auto [sn, rc] = rat::make_channel<int>();
+    run_throughput<int>("unbounded mutex", sn, rc.share(), 4, 1, n);
+  }
+  {
+    auto [sn, rc] = rat::make_channel<int>(rat::with_shared_receiver, 1024);
+    run_throughput<int>("mpmc lock-free", sn, rc, 4, 1, n);
+  }
+
+  std::cout << "# MPMC throughput (4 producers, 4 shared receivers)"
+            << std::endl;
+  {
+    auto [sn, rc] = rat::make_channel<int>(rat::with_shared_receiver);
+    run_throughput<int>("unbounded mutex", sn, rc, 4, 4, n);
+  }
+  {
+    auto [sn, rc] = rat::make_channel<int>(rat::with_shared_receiver, 1024);
+    run_throughput<int>("mpmc lock-free", sn, rc, 4, 4, n);
+  }
+
+  std::cout << "# batch vs per-element" << std::endl;
+  batch(n, 64);
+  batch(n, 512);
+
+  std::cout << "# ping-pong round trip" << std::endl;
+  ping_pong("unbounded mutex", [] { return rat::make_channel<int>(); },
+            n / 10);
+  ping_pong("spsc lock-free",
+            [] { return rat::make_channel<int>(rat::with_single_sender, 64); },
+            n / 10);
+  ping_pong("unbounded mutex, spin 1000",
+            [] { return rat::make_channel<int>(); }, n / 10, 1000);
+  ping_pong("spsc lock-free, spin 1000",
+            [] { return rat::make_channel<int>(rat::with_single_sender, 64); },
+            n / 10, 1000);
+}
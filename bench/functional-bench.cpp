@@ -0,0 +1,74 @@
+#include "../ratatoskr/functional.hpp"
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+template <class F>
+void run(const std::string &name, const std::vector<long> &input, F f) {
+  long sum = 0;
+  auto start = clock_type::now();
+  for (auto x : input) {
+    if (auto y = f(x)) {
+      sum += *y;
+    }
+  }
+  auto elapsed = clock_type::now() - start;
+  auto ns = std::chrono::duration<double, std::nano>(elapsed).count();
+  std::cout << std::left << std::setw(40) << name << std::right << std::fixed
+            << std::setprecision(2) << std::setw(10) << ns / input.size()
+            << " ns/elem  (checksum " << sum << ")" << std::endl;
+}
+
+template <std::size_t N, class Thunk>
+auto chain(Thunk t) {
+  if constexpr (N == 0) {
+    return t;
+  }
+  else {
+    return chain<N - 1>(t.map([](long x) { return x + 1; }));
+  }
+}
+
+template <std::size_t N>
+void depth(const std::vector<long> &input) {
+  run("thunk map x" + std::to_string(N), input, chain<N>(rat::thunk{}.map(
+                                                    [](long x) { return x; })));
+  run("lambda add x" + std::to_string(N), input,
+      [](long x) { return std::optional{x + static_cast<long>(N)}; });
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::size_t n = argc > 1 ? std::stoul(argv[1]) : 10000000;
+  std::vector<long> input(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    input[i] = static_cast<long>(i);
+  }
+
+  std::cout << "# thunk chain depth vs hand-written lambda" << std::endl;
+  depth<1>(input);
+  depth<4>(input);
+  depth<16>(input);
+  depth<64>(input);
+
+  std::cout << "# filter and map" << std::endl;
+  run("thunk filter.map.filter", input,
+      rat::thunk{}
+          .filter([](long x) { return x % 2 == 0; })
+          .map([](long x) { return x / 2; })
+          .filter([](long x) { return x > 5; }));
+  run("lambda filter.map.filter", input, [](long x) -> std::optional<long> {
+    if (x % 2 != 0 || x / 2 <= 5) {
+      return std::nullopt;
+    }
+    return x / 2;
+  });
+}
@@ -0,0 +1,99 @@
+#include "../ratatoskr/concurrent.hpp"
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+#ifdef RATATOSKR_PACKED_LAYOUT
+constexpr const char *layout = "packed";
+#else
+constexpr const char *layout = "padded";
+#endif
+
+void report(const std::string &name, std::size_t n,
+            clock_type::duration elapsed) {
+  auto ns = std::chrono::duration<double, std::nano>(elapsed).count();
+  std::cout << std::left << std::setw(40) << name << std::right << std::fixed
+            << std::setprecision(2) << std::setw(10) << ns / n << " ns/msg"
+            << std::endl;
+}
+
+template <std::size_t Producers, class Sender, class Receiver>
+void run(const std::string &name, Sender sn, Receiver rc, std::size_t n) {
+  auto per_producer = n / Producers;
+  auto start = clock_type::now();
+  std::thread consumer{[rc = std::move(rc)]() mutable {
+    try {
+      while (true) {
+        rc.next();
+      }
+    }
+    catch (const rat::close_channel &) {
+    }
+  }};
+  std::vector<std::thread> threads;
+  if constexpr (Producers > 1) {
+    for (std::size_t p = 0; p + 1 < Producers; ++p) {
+      threads.emplace_back([per_producer, sn = sn]() mutable {
+        for (std::size_t i = 0; i < per_producer; ++i) {
+          sn.push(static_cast<int>(i));
+        }
+      });
+    }
+  }
+  for (std::size_t i = 0; i < per_producer; ++i) {
+    sn.push(static_cast<int>(i));
+  }
+  for (auto &&th : threads) {
+    th.join();
+  }
+  sn.close();
+  consumer.join();
+  report(name, per_producer * Producers, clock_type::now() - start);
+}
+
+template <class T>
+void state_size(const std::string &name) {
+  std::cout << std::left << std::setw(40) << name << std::right
+            << std::setw(10) << sizeof(T) << " bytes" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  using namespace rat;
+
+  std::size_t n = argc > 1 ? std::stoul(argv[1]) : 5000000;
+
+  std::cout << "# " << layout << " channel states (cache line "
+            << cache_line_size << ")" << std::endl;
+  {
+    auto [sn, rc] = make_channel<int>(1024);
+    run<1>("channel_state spsc", std::move(sn), std::move(rc), n);
+  }
+  {
+    auto [sn, rc] = make_channel<int>(1024);
+    run<4>("channel_state mpsc x4", std::move(sn), std::move(rc), n);
+  }
+  {
+    auto [sn, rc] = make_channel<int>(with_single_sender, 1024);
+    run<1>("lockfree_channel_state spsc", std::move(sn), std::move(rc), n);
+  }
+  {
+    auto [sn, rc] = make_channel<int>(with_shared_receiver, 1024);
+    run<4>("lockfree_channel_state mpmc x4", std::move(sn), std::move(rc),
+           n);
+  }
+
+  std::cout << "# channel state sizes" << std::endl;
+  state_size<channel_state<int>>("channel_state<int>");
+  state_size<spsc_channel_state<int>>("lockfree_channel_state<int, spsc>");
+  state_size<mpmc_channel_state<int>>("lockfree_channel_state<int, mpmc>");
+}
@@ -0,0 +1,66 @@
+#include "../ratatoskr/functional.hpp"
+#include "../ratatoskr/signal.hpp"
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+template <class F>
+void run(const std::string &name, std::size_t n, F f) {
+  auto start = clock_type::now();
+  for (std::size_t i = 0; i < n; ++i) {
+    f(static_cast<long>(i));
+  }
+  auto elapsed = clock_type::now() - start;
+  auto ns = std::chrono::duration<double, std::nano>(elapsed).count();
+  std::cout << std::left << std::setw(40) << name << std::right << std::fixed
+            << std::setprecision(2) << std::setw(10) << ns / n << " ns/emit"
+            << std::endl;
+}
+
+template <std::size_t Slots>
+void slots(std::size_t n) {
+  long sum = 0;
+  rat::signal<long> sig;
+  std::vector<std::function<void(long)>> functions;
+  for (std::size_t i = 0; i < Slots; ++i) {
+    sig.connect([&sum](long x) { sum += x; });
+    functions.emplace_back([&sum](long x) { sum += x; });
+  }
+  run("signal x" + std::to_string(Slots), n, [&sig](long x) { sig.emit(x); });
+  run("vector<std::function> x" + std::to_string(Slots), n,
+      [&functions](long x) {
+        for (auto &&f : functions) {
+          f(x);
+        }
+      });
+  std::cout << "(checksum " << sum << ")" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::size_t n = argc > 1 ? std::stoul(argv[1]) : 10000000;
+
+  std::cout << "# emit cost by the number of slots" << std::endl;
+  slots<1>(n);
+  slots<4>(n);
+  slots<16>(n);
+
+  std::cout << "# emit through a thunk chain" << std::endl;
+  long sum = 0;
+  rat::signal<long> sig;
+  sig.connect(rat::thunk{}
+                  .filter([](long x) { return x % 2 == 0; })
+                  .map([](long x) { return x * 3; }),
+              [&sum](long x) { sum += x; });
+  run("signal filter/map", n, [&sig](long x) { sig.emit(x); });
+  std::cout << "(checksum " << sum << ")" << std::endl;
+}
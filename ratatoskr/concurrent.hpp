@@ -1,10 +1,35 @@
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#endif
+#include <cstddef>
+#include <cstdint>
+#include <exception>
 #include <forward_list>
+#include <fstream>
+#include <initializer_list>
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+#include <iterator>
 #include <memory>
 #include <mutex>
+#include <new>
 #include <optional>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include <stdexcept>
+#include <string>
 #include <thread>
+#include <tuple>
 #include <utility>
+#include <variant>
+#include <vector>
 
 #ifndef RATATOSKR_CONCURRENT_HPP
 #define RATATOSKR_CONCURRENT_HPP
@@ -12,275 +37,3530 @@
 namespace rat {
 inline namespace concurrent {
 
-template <class T>
+template <class T, class Alloc = std::allocator<T>>
 struct channel_state;
 
-template <class T>
-class channel;
+class parker;
+
+template <class T, class Queue, class Notifier = parker>
+struct lockfree_channel_state;
+
+template <class T, class State = channel_state<T>>
+class channel;
+
+template <class T, class State = channel_state<T>>
+class sender;
+
+template <class T, class State = channel_state<T>>
+class receiver;
+
+template <class T, class State = channel_state<T>>
+class shared_receiver;
+
+class channel_closer;
+
+template <class T>
+struct broadcast_state;
+
+template <class T>
+class broadcast_channel;
+
+template <class T>
+class broadcast_receiver;
+
+template <class Receiver, class F>
+class pipeline;
+
+template <class Receiver, class F, class Sender>
+class pipeline_stage;
+
+class thread_pool;
+
+class scheduler;
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+class async_task;
+
+template <class Receiver>
+class next_awaiter;
+
+template <class T, class State>
+class push_awaiter;
+#endif
+
+class close_channel : public std::exception {
+  const char *what() const noexcept { return "close_channel"; }
+};
+
+class channel_already_closed : public std::logic_error {
+  using std::logic_error::logic_error;
+};
+
+class receiver_already_retrived : public std::logic_error {
+  using std::logic_error::logic_error;
+};
+
+class sender_already_retrived : public std::logic_error {
+  using std::logic_error::logic_error;
+};
+
+struct with_shared_receiver_t {
+  explicit with_shared_receiver_t() = default;
+};
+
+inline constexpr with_shared_receiver_t with_shared_receiver =
+    with_shared_receiver_t();
+
+struct with_single_sender_t {
+  explicit with_single_sender_t() = default;
+};
+
+inline constexpr with_single_sender_t with_single_sender =
+    with_single_sender_t();
+
+template <class... Fs>
+struct overloaded : Fs... {
+  using Fs::operator()...;
+};
+
+template <class... Fs>
+overloaded(Fs...) -> overloaded<Fs...>;
+
+#ifdef RATATOSKR_CACHE_LINE_SIZE
+inline constexpr std::size_t cache_line_size = RATATOSKR_CACHE_LINE_SIZE;
+#elif defined(__cpp_lib_hardware_interference_size) && !defined(__GNUC__)
+inline constexpr std::size_t cache_line_size =
+    std::hardware_destructive_interference_size;
+#else
+inline constexpr std::size_t cache_line_size = 64;
+#endif
+
+#ifdef RATATOSKR_PACKED_LAYOUT
+#define RATATOSKR_CACHE_ALIGNED
+#else
+#define RATATOSKR_CACHE_ALIGNED alignas(cache_line_size)
+#endif
+
+enum class overflow_policy { block, drop_oldest, fail };
+
+enum class push_status { success, full, closed, no_receiver };
+
+template <class T, class Alloc = std::allocator<T>>
+class ring_buffer {
+public:
+  using allocator_type =
+      typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+
+private:
+  using traits = std::allocator_traits<allocator_type>;
+
+  allocator_type alloc;
+  T *buffer;
+  std::size_t buffer_size;
+  std::size_t head;
+  std::size_t tail;
+
+  static std::size_t round_up(std::size_t n) {
+    std::size_t size = 1;
+    while (size < n) {
+      size <<= 1;
+    }
+    return size;
+  }
+
+  T *slot(std::size_t i) const { return buffer + (i & (buffer_size - 1)); }
+
+  void reallocate(std::size_t n) {
+    auto new_buffer = traits::allocate(alloc, n);
+    for (std::size_t i = 0; head + i != tail; ++i) {
+      traits::construct(alloc, new_buffer + i, std::move(*slot(head + i)));
+      traits::destroy(alloc, slot(head + i));
+    }
+    if (buffer != nullptr) {
+      traits::deallocate(alloc, buffer, buffer_size);
+    }
+    tail -= head;
+    head = 0;
+    buffer = new_buffer;
+    buffer_size = n;
+  }
+
+public:
+  explicit ring_buffer(const allocator_type &alloc = allocator_type())
+      : alloc(alloc), buffer(nullptr), buffer_size(0), head(0), tail(0) {}
+
+  ring_buffer(const ring_buffer &) = delete;
+  ring_buffer &operator=(const ring_buffer &) = delete;
+
+  ~ring_buffer() {
+    clear();
+    if (buffer != nullptr) {
+      traits::deallocate(alloc, buffer, buffer_size);
+    }
+  }
+
+  bool empty() const { return head == tail; }
+  std::size_t size() const { return tail - head; }
+  std::size_t capacity() const { return buffer_size; }
+
+  void reserve(std::size_t n) {
+    if (n > buffer_size) {
+      reallocate(round_up(n));
+    }
+  }
+
+  template <class... Args>
+  T &emplace_back(Args &&... args) {
+    if (size() == buffer_size) {
+      reallocate(buffer_size == 0 ? 1 : buffer_size * 2);
+    }
+    traits::construct(alloc, slot(tail), std::forward<Args>(args)...);
+    return *slot(tail++);
+  }
+  void push_back(const T &x) { emplace_back(x); }
+  void push_back(T &&x) { emplace_back(std::move(x)); }
+
+  T &front() { return *slot(head); }
+  const T &front() const { return *slot(head); }
+
+  void pop_front() { traits::destroy(alloc, slot(head++)); }
+
+  void clear() {
+    while (!empty()) {
+      pop_front();
+    }
+  }
+};
+
+class channel_waiter {
+  friend class waiter_list;
+
+  channel_waiter *prev_waiter = nullptr;
+  channel_waiter *next_waiter = nullptr;
+  bool is_linked_v = false;
+
+public:
+  virtual void notify() = 0;
+
+protected:
+  ~channel_waiter() = default;
+};
+
+class waiter_list {
+  channel_waiter *head;
+
+public:
+  waiter_list() : head(nullptr) {}
+
+  waiter_list(const waiter_list &) = delete;
+  waiter_list &operator=(const waiter_list &) = delete;
+
+  bool empty() const { return head == nullptr; }
+
+  void push(channel_waiter *w) {
+    w->prev_waiter = nullptr;
+    w->next_waiter = head;
+    if (head != nullptr) {
+      head->prev_waiter = w;
+    }
+    head = w;
+    w->is_linked_v = true;
+  }
+
+  bool erase(channel_waiter *w) {
+    if (!w->is_linked_v) {
+      return false;
+    }
+    if (w->prev_waiter != nullptr) {
+      w->prev_waiter->next_waiter = w->next_waiter;
+    }
+    else {
+      head = w->next_waiter;
+    }
+    if (w->next_waiter != nullptr) {
+      w->next_waiter->prev_waiter = w->prev_waiter;
+    }
+    w->is_linked_v = false;
+    return true;
+  }
+
+  std::size_t notify_all() {
+    std::size_t n = 0;
+    while (head != nullptr) {
+      auto w = head;
+      erase(w);
+      w->notify();
+      ++n;
+    }
+    return n;
+  }
+};
+
+inline void cpu_relax() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  _mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+  __asm__ __volatile__("yield");
+#else
+  std::this_thread::yield();
+#endif
+}
+
+class spinner {
+  std::atomic<std::size_t> limit;
+  std::atomic<std::size_t> budget;
+
+public:
+  spinner() : limit(0), budget(0) {}
+
+  bool enabled() const { return budget.load(std::memory_order_relaxed) != 0; }
+
+  void set_limit(std::size_t n) {
+    limit.store(n, std::memory_order_relaxed);
+    budget.store(n, std::memory_order_relaxed);
+  }
+
+  template <class Predicate>
+  bool spin(Predicate ready) {
+    auto n = budget.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < n; ++i) {
+      if (ready()) {
+        auto max = limit.load(std::memory_order_relaxed);
+        budget.store(n < max / 2 ? n * 2 : max, std::memory_order_relaxed);
+        return true;
+      }
+      cpu_relax();
+    }
+    if (n > 1) {
+      budget.store(n / 2, std::memory_order_relaxed);
+    }
+    return false;
+  }
+};
+
+struct channel_stats {
+  std::uint64_t pushes;
+  std::uint64_t pops;
+  std::size_t depth;
+  std::size_t high_water;
+  std::chrono::nanoseconds blocked;
+  std::uint64_t contentions;
+};
+
+struct scheduler_stats {
+  std::size_t running_stages;
+  std::uint64_t runs;
+  std::uint64_t processed;
+  std::uint64_t idles;
+};
+
+#ifdef RATATOSKR_CHANNEL_STATS
+class RATATOSKR_CACHE_ALIGNED channel_counters {
+  std::atomic<std::uint64_t> pushes;
+  std::atomic<std::uint64_t> pops;
+  std::atomic<std::int64_t> blocked_ns;
+  std::atomic<std::uint64_t> contentions;
+
+public:
+  channel_counters() : pushes(0), pops(0), blocked_ns(0), contentions(0) {}
+
+  std::unique_lock<std::mutex> lock(std::mutex &m) {
+    std::unique_lock lock{m, std::try_to_lock};
+    if (!lock.owns_lock()) {
+      contentions.fetch_add(1, std::memory_order_relaxed);
+      lock.lock();
+    }
+    return lock;
+  }
+
+  void count_push(std::size_t n) {
+    pushes.fetch_add(n, std::memory_order_relaxed);
+  }
+  void count_pop(std::size_t n) {
+    pops.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  template <class Wait>
+  bool time_blocked(Wait wait) {
+    auto start = std::chrono::steady_clock::now();
+    auto result = wait();
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start);
+    blocked_ns.fetch_add(elapsed.count(), std::memory_order_relaxed);
+    return result;
+  }
+
+  void fill(channel_stats &stats) const {
+    stats.pushes = pushes.load(std::memory_order_relaxed);
+    stats.pops = pops.load(std::memory_order_relaxed);
+    stats.blocked =
+        std::chrono::nanoseconds{blocked_ns.load(std::memory_order_relaxed)};
+    stats.contentions = contentions.load(std::memory_order_relaxed);
+  }
+};
+
+class RATATOSKR_CACHE_ALIGNED scheduler_counters {
+  std::atomic<std::uint64_t> runs;
+  std::atomic<std::uint64_t> processed;
+  std::atomic<std::uint64_t> idles;
+
+public:
+  scheduler_counters() : runs(0), processed(0), idles(0) {}
+
+  void count_run() { runs.fetch_add(1, std::memory_order_relaxed); }
+  void count_processed(std::size_t n) {
+    processed.fetch_add(n, std::memory_order_relaxed);
+  }
+  void count_idle() { idles.fetch_add(1, std::memory_order_relaxed); }
+
+  void fill(scheduler_stats &stats) const {
+    stats.runs = runs.load(std::memory_order_relaxed);
+    stats.processed = processed.load(std::memory_order_relaxed);
+    stats.idles = idles.load(std::memory_order_relaxed);
+  }
+};
+#else
+class channel_counters {
+public:
+  std::unique_lock<std::mutex> lock(std::mutex &m) {
+    return std::unique_lock{m};
+  }
+
+  void count_push(std::size_t) {}
+  void count_pop(std::size_t) {}
+
+  template <class Wait>
+  bool time_blocked(Wait wait) {
+    return wait();
+  }
+
+  void fill(channel_stats &) const {}
+};
+
+class scheduler_counters {
+public:
+  void count_run() {}
+  void count_processed(std::size_t) {}
+  void count_idle() {}
+
+  void fill(scheduler_stats &) const {}
+};
+#endif
+
+template <class T, class Alloc>
+struct channel_state {
+  static constexpr bool is_single_producer = false;
+  static constexpr bool is_single_consumer = false;
+
+  RATATOSKR_CACHE_ALIGNED std::atomic<bool> has_receiver_v;
+  std::size_t capacity;
+  overflow_policy policy;
+  RATATOSKR_CACHE_ALIGNED mutable std::mutex data_mutex;
+  bool is_closed_v;
+  std::size_t senders;
+  ring_buffer<T, Alloc> data;
+  waiter_list waiters;
+  waiter_list space_waiters;
+  std::size_t sleepers;
+  std::size_t space_sleepers;
+  std::size_t high_water_v;
+  spinner spin;
+  std::atomic<std::uint64_t> sequence;
+  RATATOSKR_CACHE_ALIGNED std::condition_variable notifier;
+  std::condition_variable space_notifier;
+  channel_counters counters;
+
+  explicit channel_state(const Alloc &alloc = Alloc())
+      : has_receiver_v(false), capacity(0), policy(overflow_policy::block),
+        is_closed_v(false), senders(0), data(alloc), sleepers(0),
+        space_sleepers(0), high_water_v(0), sequence(0) {}
+  channel_state(std::size_t capacity, overflow_policy policy,
+                const Alloc &alloc = Alloc())
+      : has_receiver_v(false), capacity(capacity), policy(policy),
+        is_closed_v(false), senders(0), data(alloc), sleepers(0),
+        space_sleepers(0), high_water_v(0), sequence(0) {
+    if (capacity == 0) {
+      throw std::invalid_argument{"channel_state::channel_state"};
+    }
+    data.reserve(capacity);
+  }
+
+  bool is_bounded() const { return capacity != 0; }
+  bool is_full() const { return is_bounded() && data.size() == capacity; }
+
+  void attach_sender() {
+    std::lock_guard lock{data_mutex};
+    if (is_closed_v) {
+      throw channel_already_closed{"sender::sender"};
+    }
+    ++senders;
+  }
+
+  void retain_sender() {
+    std::lock_guard lock{data_mutex};
+    ++senders;
+  }
+
+  void release_sender() {
+    bool is_last;
+    {
+      std::lock_guard lock{data_mutex};
+      is_last = --senders == 0;
+    }
+    if (is_last) {
+      close();
+    }
+  }
+
+  void attach_receiver() {
+    std::lock_guard lock{data_mutex};
+    if (has_receiver_v) {
+      throw receiver_already_retrived{"receiver::receiver"};
+    }
+    else if (is_closed_v) {
+      throw channel_already_closed{"receiver::receiver"};
+    }
+    else {
+      has_receiver_v = true;
+    }
+  }
+
+  void detach_receiver() {
+    {
+      std::lock_guard lock{data_mutex};
+      has_receiver_v = false;
+    }
+    close(true);
+  }
+
+  template <class Wait>
+  push_status make_room(std::unique_lock<std::mutex> &lock, Wait wait) {
+    if (!is_full()) {
+      return push_status::success;
+    }
+    switch (policy) {
+    case overflow_policy::block: {
+      if (sleepers != 0) {
+        notifier.notify_all();
+      }
+      waiters.notify_all();
+      ++space_sleepers;
+      auto is_ready = wait(lock, [this] {
+        return !is_full() || is_closed_v || !has_receiver_v;
+      });
+      --space_sleepers;
+      if (!has_receiver_v) {
+        return push_status::no_receiver;
+      }
+      if (is_closed_v) {
+        return push_status::closed;
+      }
+      if (!is_ready) {
+        return push_status::full;
+      }
+      break;
+    }
+    case overflow_policy::drop_oldest:
+      data.pop_front();
+      break;
+    case overflow_policy::fail:
+      return push_status::full;
+    }
+    return push_status::success;
+  }
+
+  void notify_pushed(std::unique_lock<std::mutex> &lock, std::size_t n) {
+    auto sleeping = sleepers;
+    lock.unlock();
+    if (sleeping == 0) {
+      return;
+    }
+    if (n == 1) {
+      notifier.notify_one();
+    }
+    else if (n > 1) {
+      notifier.notify_all();
+    }
+  }
+
+  void notify_popped(std::unique_lock<std::mutex> &lock, std::size_t n) {
+    auto sleeping = space_sleepers;
+    lock.unlock();
+    if (sleeping == 0) {
+      return;
+    }
+    if (n == 1) {
+      space_notifier.notify_one();
+    }
+    else if (n > 1) {
+      space_notifier.notify_all();
+    }
+  }
+
+  push_status make_room(std::unique_lock<std::mutex> &lock) {
+    return make_room(lock, [this](auto &lock, auto ready) {
+      space_notifier.wait(lock, ready);
+      return true;
+    });
+  }
+
+  void update_high_water() {
+    if (data.size() > high_water_v) {
+      high_water_v = data.size();
+    }
+  }
+
+  void advance() { sequence.fetch_add(1, std::memory_order_release); }
+
+  template <class Wait, class... Args>
+  push_status emplace_with(Wait wait, Args &&... args) {
+    if (!has_receiver_v.load(std::memory_order_relaxed)) {
+      return push_status::no_receiver;
+    }
+    auto lock = counters.lock(data_mutex);
+    if (is_closed_v) {
+      return push_status::closed;
+    }
+    if (auto status = make_room(lock, wait); status != push_status::success) {
+      return status;
+    }
+    data.emplace_back(std::forward<Args>(args)...);
+    update_high_water();
+    advance();
+    counters.count_push(1);
+    waiters.notify_all();
+    notify_pushed(lock, 1);
+    return push_status::success;
+  }
+
+  template <class... Args>
+  push_status emplace(Args &&... args) {
+    return emplace_with(
+        [this](auto &lock, auto ready) {
+          space_notifier.wait(lock, ready);
+          return true;
+        },
+        std::forward<Args>(args)...);
+  }
+
+  template <class U>
+  push_status push(U &&x) {
+    return emplace(std::forward<U>(x));
+  }
+
+  template <class... Args>
+  push_status try_emplace(Args &&... args) {
+    return emplace_with([](auto &, auto ready) { return ready(); },
+                        std::forward<Args>(args)...);
+  }
+
+  template <class U>
+  push_status try_push(U &&x) {
+    return try_emplace(std::forward<U>(x));
+  }
+
+  template <class Clock, class Duration, class U>
+  push_status push_until(U &&x,
+                         const std::chrono::time_point<Clock, Duration> &t) {
+    return emplace_with(
+        [this, &t](auto &lock, auto ready) {
+          return space_notifier.wait_until(lock, t, ready);
+        },
+        std::forward<U>(x));
+  }
+
+  std::size_t size() const {
+    std::lock_guard lock{data_mutex};
+    return data.size();
+  }
+
+  std::size_t high_water() const {
+    std::lock_guard lock{data_mutex};
+    return high_water_v;
+  }
+
+  channel_stats stats() const {
+    channel_stats s{};
+    {
+      std::lock_guard lock{data_mutex};
+      s.depth = data.size();
+      s.high_water = high_water_v;
+    }
+    counters.fill(s);
+    return s;
+  }
+
+  template <class InputIt>
+  std::size_t push_range(InputIt first, InputIt last) {
+    if (!has_receiver_v.load(std::memory_order_relaxed)) {
+      return 0;
+    }
+    auto lock = counters.lock(data_mutex);
+    if (is_closed_v) {
+      return 0;
+    }
+    std::size_t n = 0;
+    for (; first != last; ++first, ++n) {
+      if (make_room(lock) != push_status::success) {
+        break;
+      }
+      data.emplace_back(*first);
+    }
+    if (n != 0) {
+      update_high_water();
+      advance();
+      counters.count_push(n);
+      waiters.notify_all();
+    }
+    notify_pushed(lock, n);
+    return n;
+  }
+
+  template <class OutputIt>
+  std::size_t pop_n(OutputIt out, std::size_t max) {
+    auto lock = counters.lock(data_mutex);
+    wait_readable(lock);
+
+    if (data.empty()) {
+      throw close_channel{};
+    }
+
+    std::size_t n = 0;
+    for (; n < max && !data.empty(); ++n) {
+      *out = std::move(data.front());
+      ++out;
+      data.pop_front();
+    }
+    counters.count_pop(n);
+    if (n != 0) {
+      space_waiters.notify_all();
+    }
+    notify_popped(lock, n);
+    return n;
+  }
+
+  template <class Container>
+  std::size_t drain(Container &c) {
+    auto lock = counters.lock(data_mutex);
+    std::size_t n = 0;
+    for (; !data.empty(); ++n) {
+      c.push_back(std::move(data.front()));
+      data.pop_front();
+    }
+    counters.count_pop(n);
+    if (n != 0) {
+      space_waiters.notify_all();
+    }
+    notify_popped(lock, n);
+    return n;
+  }
+
+  bool is_readable() const { return !data.empty() || is_closed_v; }
+
+  void spin_readable(std::unique_lock<std::mutex> &lock) {
+    if (is_readable() || !spin.enabled()) {
+      return;
+    }
+    auto seen = sequence.load(std::memory_order_relaxed);
+    lock.unlock();
+    spin.spin([this, seen] {
+      return sequence.load(std::memory_order_acquire) != seen;
+    });
+    lock.lock();
+  }
+
+  void wait_readable(std::unique_lock<std::mutex> &lock) {
+    spin_readable(lock);
+    if (is_readable()) {
+      return;
+    }
+    ++sleepers;
+    counters.time_blocked([this, &lock] {
+      notifier.wait(lock, [this] { return is_readable(); });
+      return true;
+    });
+    --sleepers;
+  }
+
+  template <class Clock, class Duration>
+  bool wait_readable_until(std::unique_lock<std::mutex> &lock,
+                           const std::chrono::time_point<Clock, Duration> &t) {
+    spin_readable(lock);
+    if (is_readable()) {
+      return true;
+    }
+    ++sleepers;
+    auto ready = counters.time_blocked([this, &lock, &t] {
+      return notifier.wait_until(lock, t, [this] { return is_readable(); });
+    });
+    --sleepers;
+    return ready;
+  }
+
+  T take(std::unique_lock<std::mutex> &lock) {
+    T x = std::move(data.front());
+    data.pop_front();
+    counters.count_pop(1);
+    space_waiters.notify_all();
+    notify_popped(lock, 1);
+    return x;
+  }
+
+  T pop() {
+    auto lock = counters.lock(data_mutex);
+    wait_readable(lock);
+
+    if (data.empty()) {
+      throw close_channel{};
+    }
+
+    return take(lock);
+  }
+
+  std::optional<T> try_pop() {
+    auto lock = counters.lock(data_mutex);
+    if (data.empty()) {
+      return std::nullopt;
+    }
+    return take(lock);
+  }
+
+  template <class Clock, class Duration>
+  std::optional<T>
+  pop_until(const std::chrono::time_point<Clock, Duration> &timeout) {
+    auto lock = counters.lock(data_mutex);
+    if (!wait_readable_until(lock, timeout) || data.empty()) {
+      return std::nullopt;
+    }
+    return take(lock);
+  }
+
+  bool is_closed() const {
+    std::lock_guard lock{data_mutex};
+    return is_closed_v;
+  }
+
+  bool is_drained() const {
+    std::lock_guard lock{data_mutex};
+    return is_closed_v && data.empty();
+  }
+
+  void close(bool discard = false) {
+    {
+      std::lock_guard lock{data_mutex};
+      is_closed_v = true;
+      if (discard) {
+        data.clear();
+      }
+      advance();
+      waiters.notify_all();
+      space_waiters.notify_all();
+    }
+    notifier.notify_all();
+    space_notifier.notify_all();
+  }
+
+  bool subscribe(channel_waiter *w) {
+    std::lock_guard lock{data_mutex};
+    if (!data.empty() || is_closed_v) {
+      return false;
+    }
+    waiters.push(w);
+    return true;
+  }
+
+  void unsubscribe(channel_waiter *w) {
+    std::lock_guard lock{data_mutex};
+    waiters.erase(w);
+  }
+
+  bool subscribe_space(channel_waiter *w) {
+    std::lock_guard lock{data_mutex};
+    if (!is_full() || is_closed_v || !has_receiver_v) {
+      return false;
+    }
+    space_waiters.push(w);
+    return true;
+  }
+
+  void unsubscribe_space(channel_waiter *w) {
+    std::lock_guard lock{data_mutex};
+    space_waiters.erase(w);
+  }
+
+  std::optional<T> peek() const {
+    std::lock_guard lock{data_mutex};
+    if (data.empty()) {
+      return std::nullopt;
+    }
+    return data.front();
+  }
+
+  static void close_state(void *state, bool discard) {
+    static_cast<channel_state *>(state)->close(discard);
+  }
+};
+
+class parker {
+  std::atomic<std::size_t> waiters;
+  std::mutex m;
+  std::condition_variable cv;
+  waiter_list async_waiters;
+
+  void wake_async_waiters() {
+    std::lock_guard lock{m};
+    waiters.fetch_sub(async_waiters.notify_all(), std::memory_order_relaxed);
+  }
+
+public:
+  parker() : waiters(0) {}
+
+  template <class Predicate>
+  void wait(Predicate pred) {
+    std::unique_lock lock{m};
+    waiters.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    cv.wait(lock, pred);
+    waiters.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  template <class Clock, class Duration, class Predicate>
+  bool wait_until(const std::chrono::time_point<Clock, Duration> &timeout,
+                  Predicate pred) {
+    std::unique_lock lock{m};
+    waiters.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto result = cv.wait_until(lock, timeout, pred);
+    waiters.fetch_sub(1, std::memory_order_relaxed);
+    return result;
+  }
+
+  template <class Predicate>
+  bool subscribe(channel_waiter *w, Predicate ready) {
+    std::lock_guard lock{m};
+    waiters.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (ready()) {
+      waiters.fetch_sub(1, std::memory_order_relaxed);
+      return false;
+    }
+    async_waiters.push(w);
+    return true;
+  }
+
+  void unsubscribe(channel_waiter *w) {
+    std::lock_guard lock{m};
+    if (async_waiters.erase(w)) {
+      waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+  void notify_one() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters.load(std::memory_order_relaxed) != 0) {
+      wake_async_waiters();
+      cv.notify_one();
+    }
+  }
+  void notify_all() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters.load(std::memory_order_relaxed) != 0) {
+      wake_async_waiters();
+      cv.notify_all();
+    }
+  }
+};
+
+template <class T>
+class spsc_queue {
+  using storage_type = std::aligned_storage_t<sizeof(T), alignof(T)>;
+
+  alignas(cache_line_size) std::atomic<std::size_t> head;
+  std::size_t cached_tail;
+  std::atomic<std::size_t> peak;
+  alignas(cache_line_size) std::atomic<std::size_t> tail;
+  std::size_t cached_head;
+  alignas(cache_line_size) std::size_t capacity_v;
+  std::size_t mask;
+  std::unique_ptr<storage_type[]> buffer;
+
+  static std::size_t round_up(std::size_t n) {
+    std::size_t size = 1;
+    while (size < n) {
+      size <<= 1;
+    }
+    return size;
+  }
+
+  T *slot(std::size_t i) const {
+    return std::launder(reinterpret_cast<T *>(&buffer[i & mask]));
+  }
+
+  void update_peak(std::size_t n) {
+    if (n > peak.load(std::memory_order_relaxed)) {
+      peak.store(n, std::memory_order_relaxed);
+    }
+  }
+
+public:
+  static constexpr bool is_single_producer = true;
+  static constexpr bool is_single_consumer = true;
+  static constexpr bool is_interprocess = false;
+
+  explicit spsc_queue(std::size_t capacity)
+      : head(0), cached_tail(0), peak(0), tail(0), cached_head(0),
+        capacity_v(capacity), mask(round_up(capacity) - 1),
+        buffer(std::make_unique<storage_type[]>(mask + 1)) {}
+
+  spsc_queue(const spsc_queue &) = delete;
+  spsc_queue &operator=(const spsc_queue &) = delete;
+
+  ~spsc_queue() {
+    for (auto i = head.load(std::memory_order_relaxed),
+              e = tail.load(std::memory_order_relaxed);
+         i != e; ++i) {
+      slot(i)->~T();
+    }
+  }
+
+  std::size_t capacity() const { return capacity_v; }
+
+  std::size_t size() const {
+    auto h = head.load(std::memory_order_acquire);
+    return tail.load(std::memory_order_acquire) - h;
+  }
+
+  std::size_t high_water() const {
+    return peak.load(std::memory_order_relaxed);
+  }
+
+  bool empty() const {
+    return head.load(std::memory_order_acquire) ==
+           tail.load(std::memory_order_acquire);
+  }
+  bool full() const {
+    return tail.load(std::memory_order_acquire) -
+               head.load(std::memory_order_acquire) ==
+           capacity_v;
+  }
+
+  template <class... Args>
+  bool try_emplace(Args &&... args) {
+    auto t = tail.load(std::memory_order_relaxed);
+    if (t - cached_head == capacity_v) {
+      cached_head = head.load(std::memory_order_acquire);
+      if (t - cached_head == capacity_v) {
+        return false;
+      }
+    }
+    ::new (static_cast<void *>(slot(t))) T(std::forward<Args>(args)...);
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  std::optional<T> try_pop() {
+    auto h = head.load(std::memory_order_relaxed);
+    if (h == cached_tail) {
+      cached_tail = tail.load(std::memory_order_acquire);
+      if (h == cached_tail) {
+        return std::nullopt;
+      }
+      update_peak(cached_tail - h);
+    }
+    std::optional<T> x{std::move(*slot(h))};
+    slot(h)->~T();
+    head.store(h + 1, std::memory_order_release);
+    return x;
+  }
+
+  std::optional<T> peek() {
+    auto h = head.load(std::memory_order_relaxed);
+    if (h == cached_tail) {
+      cached_tail = tail.load(std::memory_order_acquire);
+      if (h == cached_tail) {
+        return std::nullopt;
+      }
+      update_peak(cached_tail - h);
+    }
+    return *slot(h);
+  }
+};
+
+template <class T>
+class mpmc_queue {
+  using storage_type = std::aligned_storage_t<sizeof(T), alignof(T)>;
+
+  struct cell {
+    std::atomic<std::size_t> sequence;
+    storage_type storage;
+  };
+
+  alignas(cache_line_size) std::atomic<std::size_t> enqueue_position;
+  alignas(cache_line_size) std::atomic<std::size_t> dequeue_position;
+  std::atomic<std::size_t> peak;
+  alignas(cache_line_size) std::size_t mask;
+  std::unique_ptr<cell[]> buffer;
+
+  static std::size_t round_up(std::size_t n) {
+    std::size_t size = 1;
+    while (size < n) {
+      size <<= 1;
+    }
+    return size;
+  }
+
+  static T *value(cell &c) {
+    return std::launder(reinterpret_cast<T *>(&c.storage));
+  }
+
+  static std::ptrdiff_t distance(std::size_t sequence, std::size_t position) {
+    return static_cast<std::ptrdiff_t>(sequence - position);
+  }
+
+  void update_peak(std::size_t position) {
+    auto n = enqueue_position.load(std::memory_order_relaxed) - position;
+    auto p = peak.load(std::memory_order_relaxed);
+    while (n > p && n <= capacity() &&
+           !peak.compare_exchange_weak(p, n, std::memory_order_relaxed)) {
+    }
+  }
+
+public:
+  static constexpr bool is_single_producer = false;
+  static constexpr bool is_single_consumer = false;
+  static constexpr bool is_interprocess = false;
+
+  explicit mpmc_queue(std::size_t capacity)
+      : enqueue_position(0), dequeue_position(0), peak(0),
+        mask(round_up(capacity) - 1),
+        buffer(std::make_unique<cell[]>(mask + 1)) {
+    for (std::size_t i = 0; i <= mask; ++i) {
+      buffer[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  mpmc_queue(const mpmc_queue &) = delete;
+  mpmc_queue &operator=(const mpmc_queue &) = delete;
+
+  ~mpmc_queue() {
+    for (auto i = dequeue_position.load(std::memory_order_relaxed),
+              e = enqueue_position.load(std::memory_order_relaxed);
+         i != e; ++i) {
+      value(buffer[i & mask])->~T();
+    }
+  }
+
+  std::size_t capacity() const { return mask + 1; }
+
+  std::size_t size() const {
+    auto d = dequeue_position.load(std::memory_order_acquire);
+    auto n = enqueue_position.load(std::memory_order_acquire) - d;
+    return n < capacity() ? n : capacity();
+  }
+
+  std::size_t high_water() const {
+    return peak.load(std::memory_order_relaxed);
+  }
+
+  bool empty() const {
+    auto position = dequeue_position.load(std::memory_order_acquire);
+    return distance(
+               buffer[position & mask].sequence.load(std::memory_order_acquire),
+               position + 1) < 0;
+  }
+  bool full() const {
+    auto position = enqueue_position.load(std::memory_order_acquire);
+    return distance(
+               buffer[position & mask].sequence.load(std::memory_order_acquire),
+               position) < 0;
+  }
+
+  template <class... Args>
+  bool try_emplace(Args &&... args) {
+    auto position = enqueue_position.load(std::memory_order_relaxed);
+    while (true) {
+      auto &c = buffer[position & mask];
+      auto d = distance(c.sequence.load(std::memory_order_acquire), position);
+      if (d == 0) {
+        if (enqueue_position.compare_exchange_weak(
+                position, position + 1, std::memory_order_relaxed)) {
+          ::new (static_cast<void *>(&c.storage))
+              T(std::forward<Args>(args)...);
+          c.sequence.store(position + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (d < 0) {
+        return false;
+      }
+      else {
+        position = enqueue_position.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  std::optional<T> try_pop() {
+    auto position = dequeue_position.load(std::memory_order_relaxed);
+    while (true) {
+      auto &c = buffer[position & mask];
+      auto d =
+          distance(c.sequence.load(std::memory_order_acquire), position + 1);
+      if (d == 0) {
+        if (dequeue_position.compare_exchange_weak(
+                position, position + 1, std::memory_order_relaxed)) {
+          std::optional<T> x{std::move(*value(c))};
+          value(c)->~T();
+          c.sequence.store(position + mask + 1, std::memory_order_release);
+          update_peak(position);
+          return x;
+        }
+      }
+      else if (d < 0) {
+        return std::nullopt;
+      }
+      else {
+        position = dequeue_position.load(std::memory_order_relaxed);
+      }
+    }
+  }
+};
+
+template <class T, class Queue, class Notifier>
+struct lockfree_channel_state {
+  static constexpr bool is_single_producer = Queue::is_single_producer;
+  static constexpr bool is_single_consumer = Queue::is_single_consumer;
+
+  enum receiver_state : std::uint32_t { none, attached, detached };
+
+  Queue data;
+  overflow_policy policy;
+  alignas(cache_line_size) std::atomic<std::uint32_t> receiver_v;
+  std::atomic<bool> has_sender_v;
+  std::atomic<bool> is_closed_v;
+  std::atomic<bool> is_aborted_v;
+  std::atomic<std::size_t> senders;
+  RATATOSKR_CACHE_ALIGNED Notifier notifier;
+  spinner spin;
+  RATATOSKR_CACHE_ALIGNED Notifier space_notifier;
+  channel_counters counters;
+
+  template <class... Args>
+  lockfree_channel_state(std::size_t capacity, overflow_policy policy,
+                         Args &&... args)
+      : data(capacity, std::forward<Args>(args)...), policy(policy),
+        receiver_v(none), has_sender_v(false), is_closed_v(false),
+        is_aborted_v(false), senders(0) {
+    if (capacity == 0 ||
+        (is_single_consumer && policy == overflow_policy::drop_oldest)) {
+      throw std::invalid_argument{
+          "lockfree_channel_state::lockfree_channel_state"};
+    }
+  }
+
+  bool is_closed() const { return is_closed_v.load(std::memory_order_acquire); }
+  bool is_aborted() const {
+    return is_aborted_v.load(std::memory_order_acquire);
+  }
+  bool is_drained() const {
+    return is_aborted() || (is_closed() && data.empty());
+  }
+
+  void attach_sender() {
+    if (is_closed()) {
+      throw channel_already_closed{"sender::sender"};
+    }
+    retain_sender();
+  }
+
+  void retain_sender() { senders.fetch_add(1, std::memory_order_relaxed); }
+
+  void release_sender() {
+    if (senders.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      close();
+    }
+  }
+
+  void claim_sender() {
+    if (has_sender_v.exchange(true)) {
+      throw sender_already_retrived{"channel::get_sender"};
+    }
+  }
+
+  void attach_receiver() {
+    if (receiver_v.exchange(attached) == attached) {
+      throw receiver_already_retrived{"receiver::receiver"};
+    }
+    else if (is_closed()) {
+      throw channel_already_closed{"receiver::receiver"};
+    }
+  }
+
+  void detach_receiver() {
+    receiver_v.store(detached, std::memory_order_relaxed);
+    close(true);
+  }
+
+  bool has_receiver() const {
+    auto r = receiver_v.load(std::memory_order_relaxed);
+    if constexpr (Queue::is_interprocess) {
+      return r != detached;
+    }
+    else {
+      return r == attached;
+    }
+  }
+
+  push_status closed_status() const {
+    return has_receiver() ? push_status::closed : push_status::no_receiver;
+  }
+
+  template <class Wait, class... Args>
+  push_status enqueue_with(Wait wait, Args &&... args) {
+    while (!data.try_emplace(std::forward<Args>(args)...)) {
+      switch (policy) {
+      case overflow_policy::block: {
+        notifier.notify_all();
+        auto is_ready = wait([this] { return !data.full() || is_closed(); });
+        if (is_closed()) {
+          return closed_status();
+        }
+        if (!is_ready) {
+          return push_status::full;
+        }
+        break;
+      }
+      case overflow_policy::drop_oldest:
+        if constexpr (!is_single_consumer) {
+          data.try_pop();
+        }
+        break;
+      case overflow_policy::fail:
+        return push_status::full;
+      }
+    }
+    return push_status::success;
+  }
+
+  template <class... Args>
+  push_status enqueue(Args &&... args) {
+    return enqueue_with(
+        [this](auto ready) {
+          space_notifier.wait(ready);
+          return true;
+        },
+        std::forward<Args>(args)...);
+  }
+
+  T dequeue() {
+    while (true) {
+      if (is_aborted()) {
+        throw close_channel{};
+      }
+      auto closed = is_closed();
+      if (auto x = data.try_pop()) {
+        return std::move(*x);
+      }
+      if (closed) {
+        throw close_channel{};
+      }
+      if (!spin.spin([this] { return !data.empty() || is_closed(); })) {
+        counters.time_blocked([this] {
+          notifier.wait([this] { return !data.empty() || is_closed(); });
+          return true;
+        });
+      }
+    }
+  }
+
+  void notify_popped(std::size_t n) {
+    counters.count_pop(n);
+    if (policy != overflow_policy::block) {
+      return;
+    }
+    if (n == 1) {
+      space_notifier.notify_one();
+    }
+    else if (n > 1) {
+      space_notifier.notify_all();
+    }
+  }
+
+  template <class Wait, class... Args>
+  push_status emplace_with(Wait wait, Args &&... args) {
+    if (!has_receiver()) {
+      return push_status::no_receiver;
+    }
+    if (is_closed()) {
+      return push_status::closed;
+    }
+    auto status = enqueue_with(wait, std::forward<Args>(args)...);
+    if (status == push_status::success) {
+      counters.count_push(1);
+      notifier.notify_one();
+    }
+    return status;
+  }
+
+  template <class... Args>
+  push_status emplace(Args &&... args) {
+    return emplace_with(
+        [this](auto ready) {
+          space_notifier.wait(ready);
+          return true;
+        },
+        std::forward<Args>(args)...);
+  }
+
+  template <class U>
+  push_status push(U &&x) {
+    return emplace(std::forward<U>(x));
+  }
+
+  template <class... Args>
+  push_status try_emplace(Args &&... args) {
+    return emplace_with([](auto ready) { return ready(); },
+                        std::forward<Args>(args)...);
+  }
+
+  template <class U>
+  push_status try_push(U &&x) {
+    return try_emplace(std::forward<U>(x));
+  }
+
+  template <class Clock, class Duration, class U>
+  push_status push_until(U &&x,
+                         const std::chrono::time_point<Clock, Duration> &t) {
+    return emplace_with(
+        [this, &t](auto ready) { return space_notifier.wait_until(t, ready); },
+        std::forward<U>(x));
+  }
+
+  std::size_t size() const { return data.size(); }
+
+  std::size_t high_water() const { return data.high_water(); }
+
+  channel_stats stats() const {
+    channel_stats s{};
+    s.depth = size();
+    s.high_water = high_water();
+    counters.fill(s);
+    return s;
+  }
+
+  template <class InputIt>
+  std::size_t push_range(InputIt first, InputIt last) {
+    if (!has_receiver() || is_closed()) {
+      return 0;
+    }
+    std::size_t n = 0;
+    for (; first != last; ++first, ++n) {
+      if (enqueue(*first) != push_status::success) {
+        break;
+      }
+    }
+    counters.count_push(n);
+    if (n == 1) {
+      notifier.notify_one();
+    }
+    else if (n > 1) {
+      notifier.notify_all();
+    }
+    return n;
+  }
+
+  T pop() {
+    T x = dequeue();
+    notify_popped(1);
+    return x;
+  }
+
+  std::optional<T> try_pop() {
+    if (is_aborted()) {
+      return std::nullopt;
+    }
+    auto x = data.try_pop();
+    if (x) {
+      notify_popped(1);
+    }
+    return x;
+  }
+
+  std::optional<T> peek() {
+    static_assert(is_single_consumer,
+                  "Only a single-consumer queue can be peeked lock-free.");
+    if (is_aborted()) {
+      return std::nullopt;
+    }
+    return data.peek();
+  }
+
+  template <class Clock, class Duration>
+  std::optional<T>
+  pop_until(const std::chrono::time_point<Clock, Duration> &timeout) {
+    while (true) {
+      auto closed = is_closed();
+      if (auto x = try_pop()) {
+        return x;
+      }
+      if (closed || is_aborted()) {
+        return std::nullopt;
+      }
+      if (!spin.spin([this] { return !data.empty() || is_closed(); }) &&
+          !counters.time_blocked([this, &timeout] {
+            return notifier.wait_until(
+                timeout, [this] { return !data.empty() || is_closed(); });
+          })) {
+        return std::nullopt;
+      }
+    }
+  }
+
+  template <class OutputIt>
+  std::size_t pop_n(OutputIt out, std::size_t max) {
+    if (max == 0) {
+      return 0;
+    }
+    *out = dequeue();
+    ++out;
+    std::size_t n = 1;
+    for (; n < max; ++n) {
+      auto x = data.try_pop();
+      if (!x) {
+        break;
+      }
+      *out = std::move(*x);
+      ++out;
+    }
+    notify_popped(n);
+    return n;
+  }
+
+  template <class Container>
+  std::size_t drain(Container &c) {
+    if (is_aborted()) {
+      return 0;
+    }
+    std::size_t n = 0;
+    for (; auto x = data.try_pop(); ++n) {
+      c.push_back(std::move(*x));
+    }
+    notify_popped(n);
+    return n;
+  }
+
+  void close(bool discard = false) {
+    if (discard) {
+      is_aborted_v.store(true, std::memory_order_release);
+    }
+    is_closed_v.store(true, std::memory_order_release);
+    notifier.notify_all();
+    space_notifier.notify_all();
+  }
+
+  bool subscribe(channel_waiter *w) {
+    return notifier.subscribe(w,
+                              [this] { return !data.empty() || is_closed(); });
+  }
+
+  void unsubscribe(channel_waiter *w) { notifier.unsubscribe(w); }
+
+  bool subscribe_space(channel_waiter *w) {
+    return space_notifier.subscribe(
+        w, [this] { return !data.full() || is_closed(); });
+  }
+
+  void unsubscribe_space(channel_waiter *w) { space_notifier.unsubscribe(w); }
+
+  static void close_state(void *state, bool discard) {
+    static_cast<lockfree_channel_state *>(state)->close(discard);
+  }
+};
+
+template <class T>
+using spsc_channel_state = lockfree_channel_state<T, spsc_queue<T>>;
+
+template <class T>
+using mpmc_channel_state = lockfree_channel_state<T, mpmc_queue<T>>;
+
+template <class T>
+struct broadcast_state {
+  static constexpr bool is_single_producer = false;
+  static constexpr bool is_single_consumer = false;
+
+  struct cursor {
+    std::uint64_t position = 0;
+    std::uint64_t lagged = 0;
+  };
+
+  bool is_closed_v;
+  bool is_aborted_v;
+  std::size_t capacity;
+  overflow_policy policy;
+  std::unique_ptr<std::shared_ptr<const T>[]> slots;
+  std::uint64_t head;
+  std::size_t senders;
+  std::vector<cursor *> cursors;
+  waiter_list space_waiters;
+  mutable std::mutex data_mutex;
+  std::condition_variable notifier;
+  std::condition_variable space_notifier;
+
+  broadcast_state(std::size_t capacity, overflow_policy policy)
+      : is_closed_v(false), is_aborted_v(false), capacity(capacity),
+        policy(policy),
+        slots(std::make_unique<std::shared_ptr<const T>[]>(capacity)),
+        head(0),
+        senders(0) {
+    if (capacity == 0) {
+      throw std::invalid_argument{"broadcast_state::broadcast_state"};
+    }
+  }
+
+  std::shared_ptr<const T> &slot(std::uint64_t i) {
+    return slots[i % capacity];
+  }
+
+  std::uint64_t tail() const {
+    auto t = head;
+    for (auto &&c : cursors) {
+      if (c->position < t) {
+        t = c->position;
+      }
+    }
+    return t;
+  }
+
+  bool is_full() const { return head - tail() >= capacity; }
+
+  bool is_ready(const cursor &c) const {
+    return c.position != head || is_closed_v;
+  }
+
+  bool is_readable(const cursor &c) const {
+    return c.position != head && !is_aborted_v;
+  }
+
+  void attach_sender() {
+    std::lock_guard lock{data_mutex};
+    if (is_closed_v) {
+      throw channel_already_closed{"sender::sender"};
+    }
+    ++senders;
+  }
+
+  void retain_sender() {
+    std::lock_guard lock{data_mutex};
+    ++senders;
+  }
+
+  void release_sender() {
+    bool is_last;
+    {
+      std::lock_guard lock{data_mutex};
+      is_last = --senders == 0;
+    }
+    if (is_last) {
+      close();
+    }
+  }
+
+  void attach(cursor *c) {
+    std::lock_guard lock{data_mutex};
+    if (is_closed_v) {
+      throw channel_already_closed{"broadcast_receiver::broadcast_receiver"};
+    }
+    c->position = head;
+    cursors.push_back(c);
+  }
+
+  void attach(cursor *c, const cursor &from) {
+    std::lock_guard lock{data_mutex};
+    c->position = from.position;
+    cursors.push_back(c);
+  }
+
+  void detach(cursor *c) {
+    {
+      std::lock_guard lock{data_mutex};
+      for (auto it = cursors.begin(); it != cursors.end(); ++it) {
+        if (*it == c) {
+          cursors.erase(it);
+          break;
+        }
+      }
+      space_waiters.notify_all();
+    }
+    space_notifier.notify_all();
+  }
+
+  template <class Wait>
+  push_status make_room(std::unique_lock<std::mutex> &lock, Wait wait) {
+    if (!is_full()) {
+      return push_status::success;
+    }
+    switch (policy) {
+    case overflow_policy::block: {
+      auto is_ready =
+          wait(lock, [this] { return !is_full() || is_closed_v; });
+      if (is_closed_v) {
+        return push_status::closed;
+      }
+      if (!is_ready) {
+        return push_status::full;
+      }
+      break;
+    }
+    case overflow_policy::drop_oldest:
+      break;
+    case overflow_policy::fail:
+      return push_status::full;
+    }
+    return push_status::success;
+  }
+
+  push_status make_room(std::unique_lock<std::mutex> &lock) {
+    return make_room(lock, [this](auto &lock, auto ready) {
+      space_notifier.wait(lock, ready);
+      return true;
+    });
+  }
+
+  template <class Wait, class... Args>
+  push_status emplace_with(Wait wait, Args &&... args) {
+    {
+      std::unique_lock lock{data_mutex};
+      if (is_closed_v) {
+        return push_status::closed;
+      }
+      if (cursors.empty()) {
+        return push_status::no_receiver;
+      }
+      if (auto status = make_room(lock, wait);
+          status != push_status::success) {
+        return status;
+      }
+      slot(head) = std::make_shared<const T>(std::forward<Args>(args)...);
+      ++head;
+    }
+    notifier.notify_all();
+    return push_status::success;
+  }
+
+  template <class... Args>
+  push_status emplace(Args &&... args) {
+    return emplace_with(
+        [this](auto &lock, auto ready) {
+          space_notifier.wait(lock, ready);
+          return true;
+        },
+        std::forward<Args>(args)...);
+  }
+
+  template <class U>
+  push_status push(U &&x) {
+    return emplace(std::forward<U>(x));
+  }
+
+  template <class... Args>
+  push_status try_emplace(Args &&... args) {
+    return emplace_with([](auto &, auto ready) { return ready(); },
+                        std::forward<Args>(args)...);
+  }
+
+  template <class U>
+  push_status try_push(U &&x) {
+    return try_emplace(std::forward<U>(x));
+  }
+
+  template <class InputIt>
+  std::size_t push_range(InputIt first, InputIt last) {
+    std::size_t n = 0;
+    {
+      std::unique_lock lock{data_mutex};
+      if (is_closed_v || cursors.empty()) {
+        return 0;
+      }
+      for (; first != last; ++first, ++n) {
+        if (make_room(lock) != push_status::success) {
+          break;
+        }
+        slot(head) = std::make_shared<const T>(*first);
+        ++head;
+      }
+    }
+    if (n != 0) {
+      notifier.notify_all();
+    }
+    return n;
+  }
+
+  std::shared_ptr<const T> take(std::unique_lock<std::mutex> &lock,
+                                cursor &c) {
+    if (head - c.position > capacity) {
+      c.lagged += head - capacity - c.position;
+      c.position = head - capacity;
+    }
+    auto x = slot(c.position++);
+    if (policy == overflow_policy::block) {
+      space_waiters.notify_all();
+    }
+    lock.unlock();
+    if (policy == overflow_policy::block) {
+      space_notifier.notify_all();
+    }
+    return x;
+  }
+
+  std::shared_ptr<const T> pop(cursor &c) {
+    std::unique_lock lock{data_mutex};
+    notifier.wait(lock, [this, &c] { return is_ready(c); });
+
+    if (!is_readable(c)) {
+      throw close_channel{};
+    }
+
+    return take(lock, c);
+  }
+
+  std::shared_ptr<const T> try_pop(cursor &c) {
+    std::unique_lock lock{data_mutex};
+    if (!is_readable(c)) {
+      return nullptr;
+    }
+    return take(lock, c);
+  }
+
+  template <class Clock, class Duration>
+  std::shared_ptr<const T>
+  pop_until(cursor &c,
+            const std::chrono::time_point<Clock, Duration> &timeout) {
+    std::unique_lock lock{data_mutex};
+    if (!notifier.wait_until(lock, timeout,
+                             [this, &c] { return is_ready(c); }) ||
+        !is_readable(c)) {
+      return nullptr;
+    }
+    return take(lock, c);
+  }
+
+  std::uint64_t lagged(const cursor &c) const {
+    std::lock_guard lock{data_mutex};
+    return c.lagged;
+  }
+
+  bool is_closed() const {
+    std::lock_guard lock{data_mutex};
+    return is_closed_v;
+  }
+
+  bool is_drained(const cursor &c) const {
+    std::lock_guard lock{data_mutex};
+    return is_closed_v && !is_readable(c);
+  }
+
+  void close(bool discard = false) {
+    {
+      std::lock_guard lock{data_mutex};
+      is_closed_v = true;
+      is_aborted_v = is_aborted_v || discard;
+      space_waiters.notify_all();
+    }
+    notifier.notify_all();
+    space_notifier.notify_all();
+  }
+
+  bool subscribe_space(channel_waiter *w) {
+    std::lock_guard lock{data_mutex};
+    if (!is_full() || is_closed_v || cursors.empty()) {
+      return false;
+    }
+    space_waiters.push(w);
+    return true;
+  }
+
+  void unsubscribe_space(channel_waiter *w) {
+    std::lock_guard lock{data_mutex};
+    space_waiters.erase(w);
+  }
+
+  static void close_state(void *state, bool discard) {
+    static_cast<broadcast_state *>(state)->close(discard);
+  }
+};
+
+template <bool Copyable>
+struct copy_control {};
+
+template <>
+struct copy_control<false> {
+  copy_control() = default;
+  copy_control(const copy_control &) = delete;
+  copy_control &operator=(const copy_control &) = delete;
+  copy_control(copy_control &&) = default;
+  copy_control &operator=(copy_control &&) = default;
+};
+
+template <class State>
+class sender_ref {
+  std::shared_ptr<State> state;
+
+public:
+  sender_ref() {}
+  sender_ref(const std::shared_ptr<State> &state) : state(state) {
+    state->attach_sender();
+  }
+
+  sender_ref(const sender_ref &other) : state(other.state) {
+    if (state != nullptr) {
+      state->retain_sender();
+    }
+  }
+  sender_ref &operator=(const sender_ref &other) {
+    return *this = sender_ref{other};
+  }
+  sender_ref(sender_ref &&) = default;
+  sender_ref &operator=(sender_ref &&other) {
+    if (this != &other) {
+      reset();
+      state = std::move(other.state);
+    }
+    return *this;
+  }
+
+  ~sender_ref() { reset(); }
+
+  void reset() {
+    if (state != nullptr) {
+      std::exchange(state, nullptr)->release_sender();
+    }
+  }
+
+  const std::shared_ptr<State> &get() const { return state; }
+  State *operator->() const { return state.get(); }
+};
+
+class channel_closer {
+  template <class T, class State>
+  friend class channel;
+
+  template <class T, class State>
+  friend class receiver;
+
+  template <class T>
+  friend class broadcast_channel;
+
+  template <class T>
+  friend class broadcast_receiver;
+
+  template <class State>
+  channel_closer(const std::shared_ptr<State> &state)
+      : state(state), close_function(&State::close_state) {}
+  std::shared_ptr<void> state;
+  void (*close_function)(void *, bool);
+
+public:
+  void close() const { close_function(state.get(), false); }
+  void abort() const { close_function(state.get(), true); }
+};
+
+template <class T, class State>
+class channel {
+  sender_ref<State> state;
+
+public:
+  channel() : state(std::make_shared<State>()) {}
+  explicit channel(std::size_t capacity,
+                   overflow_policy policy = overflow_policy::block)
+      : state(std::make_shared<State>(capacity, policy)) {}
+
+  template <class Alloc>
+  channel(std::allocator_arg_t, const Alloc &alloc)
+      : state(std::allocate_shared<State>(alloc, alloc)) {}
+  template <class Alloc>
+  channel(std::allocator_arg_t, const Alloc &alloc, std::size_t capacity,
+          overflow_policy policy = overflow_policy::block)
+      : state(std::allocate_shared<State>(alloc, capacity, policy, alloc)) {}
+
+  sender<T, State> get_sender() const {
+    if constexpr (State::is_single_producer) {
+      state->claim_sender();
+    }
+    return sender<T, State>{state.get()};
+  }
+  receiver<T, State> get_receiver() const {
+    return receiver<T, State>{state.get()};
+  }
+  channel_closer get_closer() const { return channel_closer{state.get()}; }
+
+  push_status push(const T &x) {
+    static_assert(!State::is_single_producer,
+                  "A single-producer channel is pushed only by its sender.");
+    return state->push(x);
+  }
+  push_status push(T &&x) {
+    static_assert(!State::is_single_producer,
+                  "A single-producer channel is pushed only by its sender.");
+    return state->push(std::move(x));
+  }
+
+  template <class... Args>
+  push_status emplace(Args &&... args) {
+    static_assert(!State::is_single_producer,
+                  "A single-producer channel is pushed only by its sender.");
+    return state->emplace(std::forward<Args>(args)...);
+  }
+
+  template <class InputIt>
+  std::size_t push_range(InputIt first, InputIt last) {
+    static_assert(!State::is_single_producer,
+                  "A single-producer channel is pushed only by its sender.");
+    return state->push_range(first, last);
+  }
+  template <class Range>
+  std::size_t push_bulk(const Range &r) {
+    return push_range(std::begin(r), std::end(r));
+  }
+
+  channel_stats stats() const { return state->stats(); }
+
+  void close() { state->close(); }
+  void abort() { state->close(true); }
+
+  [[deprecated("It's only for a test.")]] auto get_state() {
+    return state.get();
+  }
+};
+
+template <class T, class State>
+class sender : copy_control<!State::is_single_producer> {
+  template <class T_, class State_>
+  friend class channel;
+
+  template <class T_>
+  friend class broadcast_channel;
+
+  friend class scheduler;
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+  friend class push_awaiter<T, State>;
+#endif
+
+  sender_ref<State> state;
+
+  sender(const std::shared_ptr<State> &state) : state(state) {}
+
+public:
+  sender() {}
+
+  sender(const sender &) = default;
+  sender &operator=(const sender &) = default;
+  sender(sender &&) = default;
+  sender &operator=(sender &&) = default;
+
+  bool avail() const { return state.get() != nullptr; }
+
+  push_status push(const T &x) { return state->push(x); }
+  push_status push(T &&x) { return state->push(std::move(x)); }
+
+  template <class... Args>
+  push_status emplace(Args &&... args) {
+    return state->emplace(std::forward<Args>(args)...);
+  }
+
+  template <class InputIt>
+  std::size_t push_range(InputIt first, InputIt last) {
+    return state->push_range(first, last);
+  }
+  template <class Range>
+  std::size_t push_bulk(const Range &r) {
+    return state->push_range(std::begin(r), std::end(r));
+  }
+
+  push_status try_push(const T &x) { return state->try_push(x); }
+  push_status try_push(T &&x) { return state->try_push(std::move(x)); }
+
+  template <class Rep, class Period>
+  push_status push_for(T x, const std::chrono::duration<Rep, Period> &d) {
+    return state->push_until(std::move(x),
+                             std::chrono::steady_clock::now() + d);
+  }
+
+  template <class Clock, class Duration>
+  push_status push_until(T x,
+                         const std::chrono::time_point<Clock, Duration> &t) {
+    return state->push_until(std::move(x), t);
+  }
+
+  std::size_t size() const { return state->size(); }
+  std::size_t high_water() const { return state->high_water(); }
+  channel_stats stats() const { return state->stats(); }
+
+  bool closed() const { return state->is_closed(); }
+
+  void close() { state->close(); }
+  void abort() { state->close(true); }
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+  push_awaiter<T, State> async_push(T x) {
+    return push_awaiter<T, State>{*this, std::move(x)};
+  }
+  push_awaiter<T, State> async_push(T x, thread_pool &pool) {
+    return push_awaiter<T, State>{*this, std::move(x), pool};
+  }
+#endif
+};
+
+template <class T, class State>
+class receiver {
+  std::shared_ptr<State> state;
+
+public:
+  receiver(const std::shared_ptr<State> &state) : state(state) {
+    state->attach_receiver();
+  }
+
+  receiver() {}
+
+  receiver(const receiver &) = delete;
+  receiver &operator=(const receiver &) = delete;
+  receiver(receiver &&) = default;
+  receiver &operator=(receiver &&other) {
+    if (this != &other) {
+      if (state != nullptr) {
+        state->detach_receiver();
+      }
+      state = std::move(other.state);
+    }
+    return *this;
+  }
+
+  ~receiver() {
+    if (state != nullptr) {
+      state->detach_receiver();
+    }
+  }
+
+  bool avail() const { return state.use_count() != 0; }
+
+  T next() { return state->pop(); }
+
+  std::optional<T> try_next() { return state->try_pop(); }
+
+  template <class Rep, class Period>
+  std::optional<T> next_for(const std::chrono::duration<Rep, Period> &d) {
+    return state->pop_until(std::chrono::steady_clock::now() + d);
+  }
+
+  template <class Clock, class Duration>
+  std::optional<T>
+  next_until(const std::chrono::time_point<Clock, Duration> &timeout) {
+    return state->pop_until(timeout);
+  }
+
+  bool closed() const { return state->is_drained(); }
+
+  bool subscribe(channel_waiter *w) { return state->subscribe(w); }
+  void unsubscribe(channel_waiter *w) { state->unsubscribe(w); }
+
+  channel_closer get_closer() const { return channel_closer{state}; }
+
+  template <class OutputIt>
+  std::size_t next_n(OutputIt out, std::size_t max) {
+    return state->pop_n(out, max);
+  }
+
+  template <class Container>
+  std::size_t try_drain(Container &c) {
+    return state->drain(c);
+  }
+
+  std::optional<T> peek() const { return state->peek(); }
+
+  template <class F>
+  decltype(auto) visit(F &&f) {
+    return std::visit(std::forward<F>(f), state->pop());
+  }
+
+  template <class F>
+  bool try_visit(F &&f) {
+    if (auto x = state->try_pop()) {
+      std::visit(std::forward<F>(f), std::move(*x));
+      return true;
+    }
+    return false;
+  }
+
+  void set_spin_count(std::size_t n) { state->spin.set_limit(n); }
+
+  std::size_t size() const { return state->size(); }
+  std::size_t high_water() const { return state->high_water(); }
+  channel_stats stats() const { return state->stats(); }
+
+  shared_receiver<T, State> share() {
+    static_assert(!State::is_single_consumer,
+                  "A single-consumer channel's receiver is not shareable.");
+    return shared_receiver<T, State>{std::move(*this)};
+  }
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+  next_awaiter<receiver> async_next() { return next_awaiter<receiver>{*this}; }
+  next_awaiter<receiver> async_next(thread_pool &pool) {
+    return next_awaiter<receiver>{*this, pool};
+  }
+#endif
+};
+
+template <class T, class State>
+class shared_receiver {
+  std::shared_ptr<receiver<T, State>> receiver_;
+
+public:
+  shared_receiver(receiver<T, State> &&receiver_)
+      : receiver_(
+            std::make_shared<receiver<T, State>>(std::move(receiver_))) {}
+
+  T next() { return receiver_->next(); }
+
+  std::optional<T> try_next() { return receiver_->try_next(); }
+
+  template <class Rep, class Period>
+  std::optional<T> next_for(const std::chrono::duration<Rep, Period> &d) {
+    return receiver_->next_for(d);
+  }
+
+  template <class Clock, class Duration>
+  std::optional<T>
+  next_until(const std::chrono::time_point<Clock, Duration> &timeout) {
+    return receiver_->next_until(timeout);
+  }
+
+  bool closed() const { return receiver_->closed(); }
+
+  bool subscribe(channel_waiter *w) { return receiver_->subscribe(w); }
+  void unsubscribe(channel_waiter *w) { receiver_->unsubscribe(w); }
+
+  channel_closer get_closer() const { return receiver_->get_closer(); }
+
+  template <class OutputIt>
+  std::size_t next_n(OutputIt out, std::size_t max) {
+    return receiver_->next_n(out, max);
+  }
+
+  template <class Container>
+  std::size_t try_drain(Container &c) {
+    return receiver_->try_drain(c);
+  }
+  std::optional<T> peek() const { return receiver_->peek(); }
+
+  template <class F>
+  decltype(auto) visit(F &&f) {
+    return receiver_->visit(std::forward<F>(f));
+  }
+
+  template <class F>
+  bool try_visit(F &&f) {
+    return receiver_->try_visit(std::forward<F>(f));
+  }
+
+  void set_spin_count(std::size_t n) { receiver_->set_spin_count(n); }
+
+  std::size_t size() const { return receiver_->size(); }
+  std::size_t high_water() const { return receiver_->high_water(); }
+  channel_stats stats() const { return receiver_->stats(); }
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+  next_awaiter<shared_receiver> async_next() {
+    return next_awaiter<shared_receiver>{*this};
+  }
+  next_awaiter<shared_receiver> async_next(thread_pool &pool) {
+    return next_awaiter<shared_receiver>{*this, pool};
+  }
+#endif
+};
+
+template <class T>
+class broadcast_receiver {
+  template <class T_>
+  friend class broadcast_channel;
+
+  using state_type = broadcast_state<T>;
+  using cursor = typename state_type::cursor;
+
+  std::shared_ptr<state_type> state;
+  std::unique_ptr<cursor> c;
+
+  broadcast_receiver(const std::shared_ptr<state_type> &state)
+      : state(state), c(std::make_unique<cursor>()) {
+    state->attach(c.get());
+  }
+
+public:
+  broadcast_receiver() {}
+
+  broadcast_receiver(const broadcast_receiver &other)
+      : state(other.state), c(std::make_unique<cursor>()) {
+    state->attach(c.get(), *other.c);
+  }
+  broadcast_receiver &operator=(const broadcast_receiver &other) {
+    if (this != &other) {
+      *this = broadcast_receiver{other};
+    }
+    return *this;
+  }
+  broadcast_receiver(broadcast_receiver &&) = default;
+  broadcast_receiver &operator=(broadcast_receiver &&other) {
+    if (c != nullptr) {
+      state->detach(c.get());
+    }
+    state = std::move(other.state);
+    c = std::move(other.c);
+    return *this;
+  }
+
+  ~broadcast_receiver() {
+    if (c != nullptr) {
+      state->detach(c.get());
+    }
+  }
+
+  bool avail() const { return c != nullptr; }
+
+  T next() { return *state->pop(*c); }
+
+  std::shared_ptr<const T> next_shared() { return state->pop(*c); }
+
+  std::optional<T> try_next() {
+    if (auto x = state->try_pop(*c)) {
+      return *x;
+    }
+    return std::nullopt;
+  }
+
+  std::shared_ptr<const T> try_next_shared() { return state->try_pop(*c); }
+
+  template <class Rep, class Period>
+  std::optional<T> next_for(const std::chrono::duration<Rep, Period> &d) {
+    return next_until(std::chrono::steady_clock::now() + d);
+  }
+
+  template <class Clock, class Duration>
+  std::optional<T>
+  next_until(const std::chrono::time_point<Clock, Duration> &timeout) {
+    if (auto x = state->pop_until(*c, timeout)) {
+      return *x;
+    }
+    return std::nullopt;
+  }
+
+  bool closed() const { return state->is_drained(*c); }
+
+  std::uint64_t lagged() const { return state->lagged(*c); }
+
+  broadcast_receiver subscribe() const { return broadcast_receiver{state}; }
+
+  channel_closer get_closer() const { return channel_closer{state}; }
+};
+
+class select_waiter {
+  class node : public channel_waiter {
+    select_waiter *owner = nullptr;
+
+  public:
+    void set_owner(select_waiter *w) { owner = w; }
+    void notify() override { owner->notify(); }
+  };
+
+  std::mutex m;
+  std::condition_variable cv;
+  bool is_notified;
+
+  void notify() {
+    std::lock_guard lock{m};
+    is_notified = true;
+    cv.notify_one();
+  }
+
+public:
+  template <std::size_t N>
+  using nodes = std::array<node, N>;
+
+  select_waiter() : is_notified(false) {}
+
+  template <std::size_t N>
+  void attach(nodes<N> &ns) {
+    for (auto &&n : ns) {
+      n.set_owner(this);
+    }
+  }
+
+  void reset() {
+    std::lock_guard lock{m};
+    is_notified = false;
+  }
+
+  void wait() {
+    std::unique_lock lock{m};
+    cv.wait(lock, [this] { return is_notified; });
+  }
+
+  template <class Clock, class Duration>
+  bool wait_until(const std::chrono::time_point<Clock, Duration> &timeout) {
+    std::unique_lock lock{m};
+    return cv.wait_until(lock, timeout, [this] { return is_notified; });
+  }
+};
+
+template <class... Receivers>
+class selector {
+public:
+  using result_type = std::variant<
+      typename decltype(std::declval<Receivers &>().try_next())::value_type...>;
+
+private:
+  static constexpr std::size_t size = sizeof...(Receivers);
+
+  std::tuple<Receivers &...> rcs;
+  select_waiter waiter;
+  select_waiter::nodes<size> nodes;
+  std::size_t start;
+
+  template <std::size_t I>
+  bool try_take(std::optional<result_type> &r) {
+    if (auto x = std::get<I>(rcs).try_next()) {
+      r.emplace(std::in_place_index<I>, std::move(*x));
+      return true;
+    }
+    return false;
+  }
+
+  template <std::size_t... I>
+  std::optional<result_type> poll(std::index_sequence<I...>) {
+    std::optional<result_type> r;
+    for (std::size_t k = 0; k < size && !r; ++k) {
+      auto i = (start + k) % size;
+      (void)((i == I && try_take<I>(r)) || ...);
+    }
+    start = (start + 1) % size;
+    return r;
+  }
+
+  template <std::size_t... I>
+  bool is_all_closed(std::index_sequence<I...>) const {
+    return (std::get<I>(rcs).closed() && ...);
+  }
+
+  template <std::size_t I>
+  bool subscribe_one(std::size_t &subscribed) {
+    auto &&rc = std::get<I>(rcs);
+    if (rc.closed()) {
+      return true;
+    }
+    if (!rc.subscribe(&nodes[I])) {
+      return false;
+    }
+    ++subscribed;
+    return true;
+  }
+
+  template <std::size_t... I>
+  bool subscribe(std::index_sequence<I...>) {
+    std::size_t subscribed = 0;
+    return (subscribe_one<I>(subscribed) && ...) && subscribed != 0;
+  }
+
+  template <std::size_t... I>
+  void unsubscribe(std::index_sequence<I...>) {
+    (std::get<I>(rcs).unsubscribe(&nodes[I]), ...);
+  }
+
+  template <class Wait>
+  std::optional<result_type> select(Wait wait) {
+    auto indices = std::index_sequence_for<Receivers...>{};
+    while (true) {
+      if (auto r = poll(indices)) {
+        return r;
+      }
+      if (is_all_closed(indices)) {
+        throw close_channel{};
+      }
+      waiter.reset();
+      auto is_subscribed = subscribe(indices);
+      auto is_notified = !is_subscribed || wait(waiter);
+      unsubscribe(indices);
+      if (!is_notified) {
+        return std::nullopt;
+      }
+    }
+  }
+
+public:
+  explicit selector(Receivers &... rcs) : rcs(rcs...), start(0) {
+    waiter.attach(nodes);
+  }
+
+  result_type operator()() {
+    return *select([](select_waiter &w) {
+      w.wait();
+      return true;
+    });
+  }
+
+  template <class Clock, class Duration>
+  std::optional<result_type>
+  until(const std::chrono::time_point<Clock, Duration> &timeout) {
+    return select([&timeout](select_waiter &w) {
+      return w.wait_until(timeout);
+    });
+  }
+};
+
+template <class... Receivers>
+auto select(Receivers &... rcs) {
+  return selector<Receivers...>{rcs...}();
+}
+
+template <class Clock, class Duration, class... Receivers>
+auto select_until(const std::chrono::time_point<Clock, Duration> &timeout,
+                  Receivers &... rcs) {
+  return selector<Receivers...>{rcs...}.until(timeout);
+}
+
+template <class Rep, class Period, class... Receivers>
+auto select_for(const std::chrono::duration<Rep, Period> &d,
+                Receivers &... rcs) {
+  return selector<Receivers...>{rcs...}.until(std::chrono::steady_clock::now() +
+                                              d);
+}
+
+template <class T>
+struct is_sender : std::false_type {};
+
+template <class T, class State>
+struct is_sender<sender<T, State>> : std::true_type {};
+
+struct flush_probe {
+  template <class T>
+  void operator()(T &&) const {}
+};
+
+template <class F, class = void>
+struct has_flush : std::false_type {};
+
+template <class F>
+struct has_flush<F, std::void_t<decltype(std::declval<F &>().flush(
+                        std::declval<flush_probe &>()))>> : std::true_type {};
+
+template <class F, class G>
+class fused_stage {
+  F f;
+  G g;
+
+public:
+  fused_stage(F &&f, G &&g) : f(std::move(f)), g(std::move(g)) {}
+
+  template <class T, class Sink>
+  void operator()(T &&x, Sink &&sink) {
+    f(std::forward<T>(x),
+      [this, &sink](auto &&y) { g(std::forward<decltype(y)>(y), sink); });
+  }
+
+  template <class Sink>
+  void flush(Sink &&sink) {
+    if constexpr (has_flush<F>::value) {
+      f.flush(
+          [this, &sink](auto &&y) { g(std::forward<decltype(y)>(y), sink); });
+    }
+    if constexpr (has_flush<G>::value) {
+      g.flush(sink);
+    }
+  }
+};
+
+template <class Receiver, class F>
+class pipeline {
+  template <class Receiver_, class F_>
+  friend class pipeline;
+
+  template <class Receiver_, class F_, class G>
+  friend auto operator|(pipeline<Receiver_, F_> &&p, G &&g);
+
+  template <class T, class State, class F_>
+  friend auto operator|(receiver<T, State> &&rc, F_ &&f);
+
+  template <class T, class State, class F_>
+  friend auto operator|(const shared_receiver<T, State> &rc, F_ &&f);
+
+  Receiver rc;
+  F f;
+
+  pipeline(Receiver &&rc, F &&f) : rc(std::move(rc)), f(std::move(f)) {}
+};
+
+template <class Receiver, class F, class Sender>
+class pipeline_stage {
+  friend class scheduler;
+
+  template <class Receiver_, class F_, class G>
+  friend auto operator|(pipeline<Receiver_, F_> &&p, G &&g);
+
+  Receiver rc;
+  F f;
+  Sender sn;
+
+  pipeline_stage(Receiver &&rc, F &&f, Sender &&sn)
+      : rc(std::move(rc)), f(std::move(f)), sn(std::move(sn)) {}
+};
+
+template <class T, class State, class F>
+auto operator|(receiver<T, State> &&rc, F &&f) {
+  return pipeline<receiver<T, State>, std::decay_t<F>>{
+      std::move(rc), std::decay_t<F>{std::forward<F>(f)}};
+}
+
+template <class T, class State, class F>
+auto operator|(const shared_receiver<T, State> &rc, F &&f) {
+  return pipeline<shared_receiver<T, State>, std::decay_t<F>>{
+      shared_receiver<T, State>{rc}, std::decay_t<F>{std::forward<F>(f)}};
+}
+
+template <class Receiver, class F, class G>
+auto operator|(pipeline<Receiver, F> &&p, G &&g) {
+  if constexpr (is_sender<std::decay_t<G>>::value) {
+    return pipeline_stage<Receiver, F, std::decay_t<G>>{
+        std::move(p.rc), std::move(p.f), std::decay_t<G>{std::forward<G>(g)}};
+  }
+  else {
+    using stage_type = fused_stage<F, std::decay_t<G>>;
+    return pipeline<Receiver, stage_type>{
+        std::move(p.rc),
+        stage_type{std::move(p.f), std::decay_t<G>{std::forward<G>(g)}}};
+  }
+}
+
+class task {
+public:
+  virtual void run() = 0;
+  virtual ~task() = default;
+};
+
+class work_stealing_deque {
+  struct array {
+    std::size_t size;
+    std::unique_ptr<std::atomic<task *>[]> slots;
+
+    explicit array(std::size_t size)
+        : size(size), slots(std::make_unique<std::atomic<task *>[]>(size)) {}
+
+    task *get(std::int64_t i) const {
+      return slots[static_cast<std::size_t>(i) & (size - 1)].load(
+          std::memory_order_relaxed);
+    }
+    void put(std::int64_t i, task *t) {
+      slots[static_cast<std::size_t>(i) & (size - 1)].store(
+          t, std::memory_order_relaxed);
+    }
+  };
+
+  alignas(cache_line_size) std::atomic<std::int64_t> top;
+  alignas(cache_line_size) std::atomic<std::int64_t> bottom;
+  std::atomic<array *> buffer;
+  std::vector<std::unique_ptr<array>> arrays;
+
+  array *grow(array *a, std::int64_t b, std::int64_t t) {
+    auto bigger = std::make_unique<array>(a->size * 2);
+    for (auto i = t; i != b; ++i) {
+      bigger->put(i, a->get(i));
+    }
+    a = bigger.get();
+    arrays.push_back(std::move(bigger));
+    buffer.store(a, std::memory_order_release);
+    return a;
+  }
+
+public:
+  explicit work_stealing_deque(std::size_t capacity = 256)
+      : top(0), bottom(0) {
+    arrays.push_back(std::make_unique<array>(capacity));
+    buffer.store(arrays.back().get(), std::memory_order_relaxed);
+  }
+
+  work_stealing_deque(const work_stealing_deque &) = delete;
+  work_stealing_deque &operator=(const work_stealing_deque &) = delete;
+
+  bool empty() const {
+    return top.load(std::memory_order_acquire) >=
+           bottom.load(std::memory_order_acquire);
+  }
+
+  void push(task *t) {
+    auto b = bottom.load(std::memory_order_relaxed);
+    auto tp = top.load(std::memory_order_acquire);
+    auto a = buffer.load(std::memory_order_relaxed);
+    if (b - tp > static_cast<std::int64_t>(a->size) - 1) {
+      a = grow(a, b, tp);
+    }
+    a->put(b, t);
+    bottom.store(b + 1, std::memory_order_release);
+  }
+
+  task *pop() {
+    auto b = bottom.load(std::memory_order_relaxed) - 1;
+    auto a = buffer.load(std::memory_order_relaxed);
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto t = top.load(std::memory_order_relaxed);
+    if (t > b) {
+      bottom.store(b + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    auto x = a->get(b);
+    if (t == b) {
+      if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                       std::memory_order_relaxed)) {
+        x = nullptr;
+      }
+      bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return x;
+  }
+
+  task *steal() {
+    auto t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto b = bottom.load(std::memory_order_acquire);
+    if (t >= b) {
+      return nullptr;
+    }
+    auto x = buffer.load(std::memory_order_acquire)->get(t);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                     std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return x;
+  }
+};
+
+class cpu_set {
+  std::vector<std::size_t> cpus;
+
+public:
+  cpu_set() {}
+  cpu_set(std::initializer_list<std::size_t> cpus) : cpus(cpus) {}
+
+  static cpu_set of_node(std::size_t node) {
+    cpu_set s;
+    std::ifstream in{"/sys/devices/system/node/node" + std::to_string(node) +
+                     "/cpulist"};
+    std::size_t first;
+    while (in >> first) {
+      auto last = first;
+      if (in.peek() == '-') {
+        in.get();
+        in >> last;
+      }
+      for (auto cpu = first; cpu <= last; ++cpu) {
+        s.add(cpu);
+      }
+      if (in.peek() == ',') {
+        in.get();
+      }
+    }
+    return s;
+  }
+
+  void add(std::size_t cpu) { cpus.push_back(cpu); }
+
+  bool empty() const { return cpus.empty(); }
+  std::size_t size() const { return cpus.size(); }
+
+  auto begin() const { return cpus.begin(); }
+  auto end() const { return cpus.end(); }
+};
+
+#if defined(__linux__)
+inline bool pin_native_thread(pthread_t th, const cpu_set &cpus) {
+  if (cpus.empty()) {
+    return false;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (auto cpu : cpus) {
+    if (cpu >= CPU_SETSIZE) {
+      return false;
+    }
+    CPU_SET(cpu, &set);
+  }
+  return pthread_setaffinity_np(th, sizeof(set), &set) == 0;
+}
+#endif
+
+inline bool pin_thread(std::thread &th, const cpu_set &cpus) {
+#if defined(__linux__)
+  return pin_native_thread(th.native_handle(), cpus);
+#else
+  (void)th;
+  (void)cpus;
+  return false;
+#endif
+}
+
+inline bool pin_this_thread(const cpu_set &cpus) {
+#if defined(__linux__)
+  return pin_native_thread(pthread_self(), cpus);
+#else
+  (void)cpus;
+  return false;
+#endif
+}
+
+class thread_pool {
+  template <class F>
+  class function_task : public task {
+    F f;
+
+  public:
+    explicit function_task(F &&f) : f(std::move(f)) {}
+
+    void run() override {
+      f();
+      delete this;
+    }
+  };
+
+  struct alignas(cache_line_size) worker {
+    work_stealing_deque tasks;
+  };
+
+  std::unique_ptr<worker[]> workers;
+  std::size_t size_v;
+  ring_buffer<task *> injected;
+  std::mutex injected_mutex;
+  std::atomic<bool> is_stopped_v;
+  parker idle;
+  cpu_set cpus;
+  std::vector<std::thread> threads;
+
+  static std::pair<thread_pool *, std::size_t> &current() {
+    static thread_local std::pair<thread_pool *, std::size_t> c{nullptr, 0};
+    return c;
+  }
+
+  task *pop_injected() {
+    std::lock_guard lock{injected_mutex};
+    if (injected.empty()) {
+      return nullptr;
+    }
+    auto t = injected.front();
+    injected.pop_front();
+    return t;
+  }
+
+  task *find_task(std::size_t index) {
+    if (auto t = workers[index].tasks.pop()) {
+      return t;
+    }
+    if (auto t = pop_injected()) {
+      return t;
+    }
+    for (std::size_t i = 1; i < size_v; ++i) {
+      if (auto t = workers[(index + i) % size_v].tasks.steal()) {
+        return t;
+      }
+    }
+    return nullptr;
+  }
+
+  bool has_task() {
+    for (std::size_t i = 0; i < size_v; ++i) {
+      if (!workers[i].tasks.empty()) {
+        return true;
+      }
+    }
+    std::lock_guard lock{injected_mutex};
+    return !injected.empty();
+  }
+
+  void work(std::size_t index) {
+    if (!cpus.empty()) {
+      pin_this_thread(cpus);
+    }
+    current() = {this, index};
+    while (true) {
+      if (auto t = find_task(index)) {
+        t->run();
+        continue;
+      }
+      if (is_stopped_v.load(std::memory_order_acquire)) {
+        break;
+      }
+      idle.wait([this] {
+        return is_stopped_v.load(std::memory_order_acquire) || has_task();
+      });
+    }
+    current() = {nullptr, 0};
+  }
+
+public:
+  explicit thread_pool(std::size_t size, cpu_set cpus = cpu_set())
+      : workers(std::make_unique<worker[]>(size == 0 ? 1 : size)),
+        size_v(size == 0 ? 1 : size), is_stopped_v(false),
+        cpus(std::move(cpus)) {
+    threads.reserve(size_v);
+    for (std::size_t i = 0; i < size_v; ++i) {
+      threads.emplace_back([this, i] { work(i); });
+    }
+  }
+
+  thread_pool(const thread_pool &) = delete;
+  thread_pool &operator=(const thread_pool &) = delete;
+
+  ~thread_pool() {
+    is_stopped_v.store(true, std::memory_order_release);
+    idle.notify_all();
+    for (auto &&th : threads) {
+      th.join();
+    }
+  }
+
+  std::size_t size() const { return size_v; }
+
+  static thread_pool *current_pool() { return current().first; }
+
+  void submit(task *t) {
+    if (auto [pool, index] = current(); pool == this) {
+      workers[index].tasks.push(t);
+    }
+    else {
+      std::lock_guard lock{injected_mutex};
+      injected.push_back(t);
+    }
+    idle.notify_one();
+  }
+
+  void defer(task *t) {
+    {
+      std::lock_guard lock{injected_mutex};
+      injected.push_back(t);
+    }
+    idle.notify_one();
+  }
+
+  template <class F>
+  void post(F &&f) {
+    submit(new function_task<std::decay_t<F>>{std::forward<F>(f)});
+  }
 
-template <class T>
-class sender;
+  template <class F>
+  void bulk(std::size_t n, F &&f) {
+    class bulk_state {
+      std::decay_t<F> f;
+      std::size_t n;
+      std::atomic<std::size_t> next;
+      std::size_t done;
+      std::exception_ptr error;
+      std::mutex mutex;
+      std::condition_variable finished;
 
-template <class T>
-class receiver;
+    public:
+      bulk_state(F &&f, std::size_t n)
+          : f(std::forward<F>(f)), n(n), next(0), done(0) {}
 
-template <class T>
-class shared_receiver;
+      void run() {
+        std::size_t count = 0;
+        for (auto i = next.fetch_add(1, std::memory_order_relaxed); i < n;
+             i = next.fetch_add(1, std::memory_order_relaxed), ++count) {
+          try {
+            f(i);
+          }
+          catch (...) {
+            std::lock_guard lock{mutex};
+            if (!error) {
+              error = std::current_exception();
+            }
+          }
+        }
+        if (count != 0) {
+          std::lock_guard lock{mutex};
+          done += count;
+          if (done == n) {
+            finished.notify_all();
+          }
+        }
+      }
 
-class channel_closer;
+      void wait() {
+        std::unique_lock lock{mutex};
+        finished.wait(lock, [this] { return done == n; });
+        if (error) {
+          std::rethrow_exception(error);
+        }
+      }
+    };
 
-class scheduler;
+    if (n == 0) {
+      return;
+    }
+    auto state = std::make_shared<bulk_state>(std::forward<F>(f), n);
+    for (std::size_t i = 1; i < n && i < size_v; ++i) {
+      post([state] { state->run(); });
+    }
+    state->run();
+    state->wait();
+  }
 
-class close_channel : public std::exception {
-  const char *what() const noexcept { return "close_channel"; }
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+  void spawn(async_task t);
+#endif
 };
 
-class channel_already_closed : public std::logic_error {
-  using std::logic_error::logic_error;
-};
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+class async_task {
+public:
+  struct promise_type {
+    void (*on_done)(void *) = nullptr;
+    void *context = nullptr;
 
-class receiver_already_retrived : public std::logic_error {
-  using std::logic_error::logic_error;
-};
+    async_task get_return_object() {
+      return async_task{
+          std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
 
-struct with_shared_receiver_t {
-  explicit with_shared_receiver_t() = default;
-};
+    std::suspend_always initial_suspend() noexcept { return {}; }
 
-inline constexpr with_shared_receiver_t with_shared_receiver =
-    with_shared_receiver_t();
+    auto final_suspend() noexcept {
+      struct final_awaiter {
+        bool await_ready() noexcept { return false; }
+        void await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+          auto on_done = h.promise().on_done;
+          auto context = h.promise().context;
+          h.destroy();
+          if (on_done != nullptr) {
+            on_done(context);
+          }
+        }
+        void await_resume() noexcept {}
+      };
+      return final_awaiter{};
+    }
 
-template <class T>
-struct channel_state {
-  bool has_receiver_v;
-  bool is_closed_v;
-  std::forward_list<std::optional<T>> data;
-  mutable std::mutex data_mutex;
-  typename std::forward_list<std::optional<T>>::iterator last;
-  std::condition_variable notifier;
+    void return_void() {}
 
-  channel_state()
-      : is_closed_v(false), data{std::nullopt}, last(data.begin()) {}
-};
+    void unhandled_exception() {
+      try {
+        throw;
+      }
+      catch (const close_channel &) {
+      }
+      catch (...) {
+        std::terminate();
+      }
+    }
+  };
 
-class channel_closer {
-  template <class T>
-  friend class channel;
+private:
+  std::coroutine_handle<promise_type> h;
 
-  template <class T>
-  channel_closer(const std::shared_ptr<channel_state<T>> &state)
-      : reference_counter(state), is_closed_v(state->is_closed_v),
-        data_mutex(state->data_mutex), notifier(state->notifier) {}
-  std::shared_ptr<void> reference_counter;
-  bool &is_closed_v;
-  std::mutex &data_mutex;
-  std::condition_variable &notifier;
+  explicit async_task(std::coroutine_handle<promise_type> h) : h(h) {}
 
 public:
-  void close() const {
-    {
-      std::lock_guard lock{data_mutex};
-      is_closed_v = true;
+  async_task(const async_task &) = delete;
+  async_task &operator=(const async_task &) = delete;
+  async_task(async_task &&other) : h(std::exchange(other.h, {})) {}
+  async_task &operator=(async_task &&other) {
+    if (h) {
+      h.destroy();
+    }
+    h = std::exchange(other.h, {});
+    return *this;
+  }
+
+  ~async_task() {
+    if (h) {
+      h.destroy();
     }
-    notifier.notify_all();
   }
+
+  void on_done(void (*f)(void *), void *context) {
+    h.promise().on_done = f;
+    h.promise().context = context;
+  }
+
+  std::coroutine_handle<> release() { return std::exchange(h, {}); }
 };
 
-template <class T>
-class channel {
-  std::shared_ptr<channel_state<T>> state;
+template <class Receiver>
+class next_awaiter : public task, public channel_waiter {
+  using value_type =
+      typename decltype(std::declval<Receiver &>().try_next())::value_type;
+
+  Receiver &rc;
+  thread_pool *pool;
+  std::optional<value_type> value;
+  std::coroutine_handle<> h;
+  bool is_suspended;
+
+  bool is_ready() {
+    value = rc.try_next();
+    return value || rc.closed();
+  }
 
 public:
-  channel() : state(std::make_shared<channel_state<T>>()) {}
+  explicit next_awaiter(Receiver &rc)
+      : rc(rc), pool(thread_pool::current_pool()), is_suspended(false) {}
+  next_awaiter(Receiver &rc, thread_pool &pool)
+      : rc(rc), pool(&pool), is_suspended(false) {}
 
-  sender<T> get_sender() const { return sender<T>{state}; }
-  receiver<T> get_receiver() const { return receiver<T>{state}; }
-  channel_closer get_closer() const { return channel_closer{state}; }
+  next_awaiter(const next_awaiter &) = delete;
+  next_awaiter &operator=(const next_awaiter &) = delete;
 
-  void push(const T &x) {
-    {
-      std::lock_guard lock{state->data_mutex};
-      if (!state->has_receiver_v) {
-        return;
-      }
-      state->data.insert_after(state->last, x);
-      ++state->last;
+  ~next_awaiter() {
+    if (is_suspended) {
+      rc.unsubscribe(this);
     }
-    state->notifier.notify_one();
   }
-  void push(T &&x) {
-    {
-      std::lock_guard lock{state->data_mutex};
-      if (!state->has_receiver_v) {
-        return;
-      }
-      state->data.insert_after(state->last, std::move(x));
-      ++state->last;
+
+  void notify() override { pool->submit(this); }
+
+  void run() override {
+    if (is_ready()) {
+      h.resume();
+    }
+    else if (!rc.subscribe(this)) {
+      pool->submit(this);
     }
-    state->notifier.notify_one();
   }
-  void close() {
-    {
-      std::lock_guard lock{state->data_mutex};
-      state->is_closed_v = true;
+
+  bool await_ready() { return is_ready(); }
+
+  bool await_suspend(std::coroutine_handle<> h_) {
+    if (pool == nullptr) {
+      throw std::logic_error{"receiver::async_next"};
+    }
+    h = h_;
+    is_suspended = true;
+    while (!rc.subscribe(this)) {
+      if (is_ready()) {
+        return false;
+      }
     }
-    state->notifier.notify_all();
+    return true;
   }
 
-  [[deprecated("It's only for a test.")]] auto get_state() { return state; }
+  value_type await_resume() {
+    if (!value) {
+      throw close_channel{};
+    }
+    return std::move(*value);
+  }
 };
 
-template <class T>
-class sender {
-  template <class T_>
-  friend class channel;
-
-  std::shared_ptr<channel_state<T>> state;
+template <class T, class State>
+class push_awaiter : public task, public channel_waiter {
+  sender<T, State> &sn;
+  thread_pool *pool;
+  T value;
+  push_status status;
+  std::coroutine_handle<> h;
+  bool is_suspended;
 
-  sender(const std::shared_ptr<channel_state<T>> &state) : state(state) {
-    std::lock_guard lock{state->data_mutex};
-    if (state->is_closed_v) {
-      throw channel_already_closed{"sender::sender"};
-    }
+  bool is_ready() {
+    status = sn.state->try_push(std::move(value));
+    return status != push_status::full ||
+           sn.state->policy != overflow_policy::block;
   }
 
 public:
-  sender() {}
+  push_awaiter(sender<T, State> &sn, T &&x)
+      : sn(sn), pool(thread_pool::current_pool()), value(std::move(x)),
+        status(push_status::success), is_suspended(false) {}
+  push_awaiter(sender<T, State> &sn, T &&x, thread_pool &pool)
+      : sn(sn), pool(&pool), value(std::move(x)),
+        status(push_status::success), is_suspended(false) {}
 
-  bool avail() const { return state.use_count() != 0; }
+  push_awaiter(const push_awaiter &) = delete;
+  push_awaiter &operator=(const push_awaiter &) = delete;
 
-  void push(const T &x) {
-    {
-      std::lock_guard lock{state->data_mutex};
-      if (!state->has_receiver_v) {
-        return;
-      }
-      state->data.insert_after(state->last, x);
-      ++state->last;
+  ~push_awaiter() {
+    if (is_suspended) {
+      sn.state->unsubscribe_space(this);
     }
-    state->notifier.notify_one();
   }
-  void push(T &&x) {
-    {
-      std::lock_guard lock{state->data_mutex};
-      if (!state->has_receiver_v) {
-        return;
-      }
-      state->data.insert_after(state->last, std::move(x));
-      ++state->last;
+
+  void notify() override { pool->submit(this); }
+
+  void run() override {
+    if (is_ready()) {
+      h.resume();
+    }
+    else if (!sn.state->subscribe_space(this)) {
+      pool->submit(this);
     }
-    state->notifier.notify_one();
   }
-  void close() {
-    {
-      std::lock_guard lock{state->data_mutex};
-      state->is_closed_v = true;
+
+  bool await_ready() { return is_ready(); }
+
+  bool await_suspend(std::coroutine_handle<> h_) {
+    if (pool == nullptr) {
+      throw std::logic_error{"sender::async_push"};
+    }
+    h = h_;
+    is_suspended = true;
+    while (!sn.state->subscribe_space(this)) {
+      if (is_ready()) {
+        return false;
+      }
     }
-    state->notifier.notify_all();
+    return true;
   }
+
+  push_status await_resume() { return status; }
 };
 
-template <class T>
-class receiver {
-  std::shared_ptr<channel_state<T>> state;
-  typename std::forward_list<std::optional<T>>::iterator iterator;
+inline void thread_pool::spawn(async_task t) {
+  post([h = t.release()] { h.resume(); });
+}
+#endif
 
-public:
-  receiver(const std::shared_ptr<channel_state<T>> &state)
-      : state(state),
-        iterator((std::lock_guard{state->data_mutex}, state->last)) {
-    std::lock_guard lock{state->data_mutex};
-    if (state->has_receiver_v) {
-      throw receiver_already_retrived{"receiver::receiver"};
+class scheduler {
+  class no_output {
+  public:
+    template <class F, class T>
+    void apply(F &f, T &&x) {
+      f(std::forward<T>(x));
     }
-    else if (state->is_closed_v) {
-      throw channel_already_closed{"receiver::receiver"};
+
+    template <class F>
+    void flush(F &) {}
+
+    bool resume() { return true; }
+    bool is_blocked() const { return false; }
+
+    bool subscribe(channel_waiter *) { return false; }
+    void unsubscribe(channel_waiter *) {}
+
+    void close() {}
+  };
+
+  template <class Sender>
+  class output;
+
+  template <class T, class State>
+  class output<sender<T, State>> {
+    channel_closer upstream;
+    sender<T, State> sn;
+    ring_buffer<T> pending;
+
+    bool is_delivered(push_status status) {
+      switch (status) {
+      case push_status::full:
+        return sn.state->policy != overflow_policy::block;
+      case push_status::closed:
+      case push_status::no_receiver:
+        throw close_channel{};
+      default:
+        return true;
+      }
     }
-    else {
-      state->has_receiver_v = true;
+
+  public:
+    output(channel_closer &&upstream, sender<T, State> &&sn)
+        : upstream(std::move(upstream)), sn(std::move(sn)) {}
+
+    template <class U>
+    void operator()(U &&x) {
+      if (!pending.empty() ||
+          !is_delivered(sn.state->try_push(std::forward<U>(x)))) {
+        pending.emplace_back(std::forward<U>(x));
+      }
     }
-  }
 
-  receiver() {}
+    template <class F, class U>
+    void apply(F &f, U &&x) {
+      f(std::forward<U>(x), *this);
+    }
 
-  receiver(const receiver &) = delete;
-  receiver &operator=(const receiver &) = delete;
-  receiver(receiver &&) = default;
-  receiver &operator=(receiver &&) = default;
+    template <class F>
+    void flush(F &f) {
+      upstream.abort();
+      if constexpr (has_flush<F>::value) {
+        f.flush(*this);
+      }
+    }
 
-  bool avail() const { return state.use_count() != 0; }
+    bool resume() {
+      while (!pending.empty()) {
+        if (!is_delivered(sn.state->try_push(std::move(pending.front())))) {
+          return false;
+        }
+        pending.pop_front();
+      }
+      return true;
+    }
 
-  T next() {
-    std::unique_lock lock{state->data_mutex};
-    state->notifier.wait(lock, [this] {
-      auto next = iterator;
-      return ++next != state->data.end() || state->is_closed_v;
-    });
+    bool is_blocked() const { return !pending.empty(); }
 
-    if (state->is_closed_v) {
-      throw close_channel{};
+    bool subscribe(channel_waiter *w) { return sn.state->subscribe_space(w); }
+    void unsubscribe(channel_waiter *w) { sn.state->unsubscribe_space(w); }
+
+    void close() { sn.close(); }
+  };
+
+  template <class Receiver, class F, class Output>
+  class stage : public task, public channel_waiter {
+    static constexpr std::size_t batch_size = 64;
+
+    scheduler &owner;
+    Receiver rc;
+    F f;
+    Output out;
+    bool is_draining;
+    bool is_waiting_space;
+
+    void finish_stage() {
+      out.close();
+      owner.finish_stage();
     }
 
-    ++iterator;
-    state->data.pop_front();
-    return **iterator;
-  }
+    void wait_space() {
+      is_waiting_space = true;
+      if (!out.subscribe(this)) {
+        is_waiting_space = false;
+        owner.pool->submit(this);
+      }
+    }
 
-  std::optional<T> operator*() {
-    std::lock_guard lock{state->data_mutex};
-    return *iterator;
-  }
+    void drain() {
+      is_draining = true;
+      try {
+        out.flush(f);
+        if (out.is_blocked()) {
+          wait_space();
+          return;
+        }
+      }
+      catch (const close_channel &) {
+      }
+      finish_stage();
+    }
 
-  shared_receiver<T> share() { return shared_receiver<T>{std::move(*this)}; }
-};
+    void resume_drain() {
+      try {
+        if (!out.resume()) {
+          wait_space();
+          return;
+        }
+      }
+      catch (const close_channel &) {
+      }
+      finish_stage();
+    }
 
-template <class T>
-class shared_receiver {
-  std::shared_ptr<receiver<T>> receiver_;
+  public:
+    template <class... Args>
+    stage(scheduler &owner, Receiver &&rc, F &&f, Args &&... args)
+        : owner(owner), rc(std::move(rc)), f(std::move(f)),
+          out(std::forward<Args>(args)...), is_draining(false),
+          is_waiting_space(false) {}
 
-public:
-  shared_receiver(receiver<T> &&receiver_)
-      : receiver_(std::make_shared<receiver<T>>(std::move(receiver_))) {}
+    ~stage() {
+      if (is_waiting_space) {
+        out.unsubscribe(this);
+      }
+      else {
+        rc.unsubscribe(this);
+      }
+    }
 
-  T next() { return receiver_->next(); }
-  auto operator*() { return receiver_->operator*(); }
-};
+    void notify() override { owner.pool->submit(this); }
+
+    void run() override {
+      owner.counters.count_run();
+      is_waiting_space = false;
+      if (is_draining) {
+        resume_drain();
+        return;
+      }
+      std::size_t i = 0;
+      try {
+        if (!out.resume()) {
+          wait_space();
+          return;
+        }
+        for (; i < batch_size; ++i) {
+          auto x = rc.try_next();
+          if (!x) {
+            owner.counters.count_processed(i);
+            if (rc.closed()) {
+              drain();
+            }
+            else if (!rc.subscribe(this)) {
+              owner.pool->submit(this);
+            }
+            else {
+              owner.counters.count_idle();
+            }
+            return;
+          }
+          out.apply(f, std::move(*x));
+          if (out.is_blocked()) {
+            owner.counters.count_processed(i + 1);
+            wait_space();
+            return;
+          }
+        }
+      }
+      catch (const close_channel &) {
+        owner.counters.count_processed(i);
+        drain();
+        return;
+      }
+      owner.counters.count_processed(i);
+      owner.pool->defer(this);
+    }
+  };
 
-class scheduler {
   std::forward_list<rat::channel_closer> closers;
   std::forward_list<std::thread> threads;
+  std::forward_list<std::unique_ptr<task>> stages;
+  std::size_t running_stages;
   bool is_closed_v;
+  std::size_t pool_size;
+  cpu_set cpus;
+  std::unique_ptr<thread_pool> pool;
+  scheduler_counters counters;
   mutable std::mutex m;
   mutable std::condition_variable cv;
 
+  void finish_stage() {
+    {
+      std::lock_guard lock{m};
+      --running_stages;
+    }
+    cv.notify_all();
+  }
+
+  template <class Output, class Receiver, class F, class... Args>
+  void connect_stage(Receiver &&rc, F &&f, Args &&... args) {
+    auto closer = rc.get_closer();
+    auto s = std::make_unique<
+        stage<std::decay_t<Receiver>, std::decay_t<F>, Output>>(
+        *this, std::move(rc), std::forward<F>(f), std::forward<Args>(args)...);
+    auto p = s.get();
+    {
+      std::lock_guard lock{m};
+      if (pool == nullptr) {
+        pool = std::make_unique<thread_pool>(pool_size, cpus);
+      }
+      if (is_closed_v) {
+        closer.abort();
+      }
+      else {
+        closers.push_front(std::move(closer));
+      }
+      stages.push_front(std::move(s));
+      ++running_stages;
+    }
+    pool->submit(p);
+  }
+
 public:
-  scheduler() : is_closed_v(false) {}
+  scheduler()
+      : running_stages(0), is_closed_v(false),
+        pool_size(std::thread::hardware_concurrency()) {}
+  explicit scheduler(std::size_t pool_size)
+      : running_stages(0), is_closed_v(false), pool_size(pool_size) {}
+  scheduler(std::size_t pool_size, cpu_set cpus)
+      : running_stages(0), is_closed_v(false), pool_size(pool_size),
+        cpus(std::move(cpus)) {}
+
+  scheduler(const scheduler &) = delete;
+  scheduler &operator=(const scheduler &) = delete;
+
+  ~scheduler() {
+    if (pool != nullptr) {
+      halt();
+      {
+        std::unique_lock lock{m};
+        cv.wait(lock, [this] { return running_stages == 0; });
+      }
+      pool.reset();
+    }
+  }
+
+  thread_pool &get_pool() {
+    std::lock_guard lock{m};
+    if (pool == nullptr) {
+      pool = std::make_unique<thread_pool>(pool_size, cpus);
+    }
+    return *pool;
+  }
+
+  scheduler_stats stats() const {
+    scheduler_stats s{};
+    {
+      std::lock_guard lock{m};
+      s.running_stages = running_stages;
+    }
+    counters.fill(s);
+    return s;
+  }
 
   void halt() {
     {
       std::lock_guard lock{m};
       is_closed_v = true;
       for (auto &&c : closers) {
-        c.close();
+        c.abort();
       }
     }
     cv.notify_all();
   }
 
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+  void spawn(async_task t) {
+    t.on_done([](void *s) { static_cast<scheduler *>(s)->finish_stage(); },
+              this);
+    {
+      std::lock_guard lock{m};
+      ++running_stages;
+    }
+    get_pool().spawn(std::move(t));
+  }
+  void spawn(async_task t, const channel_closer &closer) {
+    {
+      std::lock_guard lock{m};
+      if (is_closed_v) {
+        closer.abort();
+      }
+      else {
+        closers.push_front(closer);
+      }
+    }
+    spawn(std::move(t));
+  }
+#endif
+
   void connect(std::thread &&th, const rat::channel_closer &closer) {
     std::lock_guard lock{m};
     if (is_closed_v) {
-      closer.close();
+      closer.abort();
       th.join();
       return;
     }
     threads.emplace_front(std::move(th));
     closers.push_front(closer);
   }
+  void connect(std::thread &&th, const rat::channel_closer &closer,
+               const cpu_set &cpus) {
+    pin_thread(th, cpus);
+    connect(std::move(th), closer);
+  }
   void connect(std::thread &&th, rat::channel_closer &&closer) {
     std::lock_guard lock{m};
     if (is_closed_v) {
-      closer.close();
+      closer.abort();
       th.join();
       return;
     }
@@ -292,7 +3572,7 @@ public:
                const rat::channel_closer &closer) {
     std::lock_guard lock{m};
     if (is_closed_v) {
-      closer.close();
+      closer.abort();
       for (auto &&th : ths) {
         th.join();
       }
@@ -305,7 +3585,7 @@ public:
                const rat::channel_closer &closer) {
     std::lock_guard lock{m};
     if (is_closed_v) {
-      closer.close();
+      closer.abort();
       for (auto &&th : ths) {
         th.join();
       }
@@ -315,12 +3595,30 @@ public:
     closers.push_front(closer);
   }
 
+  template <class T, class State, class F>
+  void connect(receiver<T, State> &&rc, F &&f) {
+    connect_stage<no_output>(std::move(rc), std::forward<F>(f));
+  }
+  template <class T, class State, class F>
+  void connect(const shared_receiver<T, State> &rc, F &&f) {
+    connect_stage<no_output>(shared_receiver<T, State>{rc},
+                             std::forward<F>(f));
+  }
+
+  template <class Receiver, class F, class Sender>
+  void connect(pipeline_stage<Receiver, F, Sender> &&p) {
+    auto upstream = p.rc.get_closer();
+    connect_stage<output<Sender>>(std::move(p.rc), std::move(p.f),
+                                  std::move(upstream), std::move(p.sn));
+  }
+
   void wait() {
     std::unique_lock lock{m};
     cv.wait(lock, [this] { return is_closed_v; });
     for (auto &&th : threads) {
       th.join();
     }
+    cv.wait(lock, [this] { return running_stages == 0; });
   }
 };
 
@@ -330,12 +3628,102 @@ auto make_channel() {
   return std::pair{ch.get_sender(), ch.get_receiver()};
 }
 
+template <class T, class U, class... Ts>
+auto make_channel() {
+  return make_channel<std::variant<T, U, Ts...>>();
+}
+
 template <class T>
 auto make_channel(with_shared_receiver_t) {
   channel<T> ch;
   return std::pair{ch.get_sender(), ch.get_receiver().share()};
 }
 
+template <class T>
+auto make_channel(std::size_t capacity,
+                  overflow_policy policy = overflow_policy::block) {
+  channel<T> ch{capacity, policy};
+  return std::pair{ch.get_sender(), ch.get_receiver()};
+}
+
+template <class T, class U, class... Ts>
+auto make_channel(std::size_t capacity,
+                  overflow_policy policy = overflow_policy::block) {
+  return make_channel<std::variant<T, U, Ts...>>(capacity, policy);
+}
+
+template <class T>
+auto make_channel(with_shared_receiver_t, std::size_t capacity,
+                  overflow_policy policy = overflow_policy::block) {
+  channel<T, mpmc_channel_state<T>> ch{capacity, policy};
+  return std::pair{ch.get_sender(), ch.get_receiver().share()};
+}
+
+template <class T, class Alloc>
+auto make_channel(std::allocator_arg_t, const Alloc &alloc) {
+  channel<T, channel_state<T, Alloc>> ch{std::allocator_arg, alloc};
+  return std::pair{ch.get_sender(), ch.get_receiver()};
+}
+
+template <class T, class Alloc>
+auto make_channel(std::allocator_arg_t, const Alloc &alloc,
+                  std::size_t capacity,
+                  overflow_policy policy = overflow_policy::block) {
+  channel<T, channel_state<T, Alloc>> ch{std::allocator_arg, alloc, capacity,
+                                         policy};
+  return std::pair{ch.get_sender(), ch.get_receiver()};
+}
+
+template <class T, class Alloc>
+auto make_channel(std::allocator_arg_t, const Alloc &alloc,
+                  with_shared_receiver_t) {
+  channel<T, channel_state<T, Alloc>> ch{std::allocator_arg, alloc};
+  return std::pair{ch.get_sender(), ch.get_receiver().share()};
+}
+
+template <class T>
+auto make_channel(with_single_sender_t, std::size_t capacity,
+                  overflow_policy policy = overflow_policy::block) {
+  channel<T, spsc_channel_state<T>> ch{capacity, policy};
+  return std::pair{ch.get_sender(), ch.get_receiver()};
+}
+
+template <class T>
+class broadcast_channel {
+  sender_ref<broadcast_state<T>> state;
+
+public:
+  explicit broadcast_channel(std::size_t capacity,
+                             overflow_policy policy = overflow_policy::block)
+      : state(std::make_shared<broadcast_state<T>>(capacity, policy)) {}
+
+  sender<T, broadcast_state<T>> get_sender() const {
+    return sender<T, broadcast_state<T>>{state.get()};
+  }
+  broadcast_receiver<T> subscribe() const {
+    return broadcast_receiver<T>{state.get()};
+  }
+  channel_closer get_closer() const { return channel_closer{state.get()}; }
+
+  push_status push(const T &x) { return state->push(x); }
+  push_status push(T &&x) { return state->push(std::move(x)); }
+
+  template <class... Args>
+  push_status emplace(Args &&... args) {
+    return state->emplace(std::forward<Args>(args)...);
+  }
+
+  void close() { state->close(); }
+  void abort() { state->close(true); }
+};
+
+template <class T>
+auto make_broadcast_channel(std::size_t capacity,
+                            overflow_policy policy = overflow_policy::block) {
+  broadcast_channel<T> ch{capacity, policy};
+  return std::pair{ch.get_sender(), ch.subscribe()};
+}
+
 } // namespace concurrent
 } // namespace rat
 #endif
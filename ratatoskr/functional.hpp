@@ -1,5 +1,11 @@
+#include <cstddef>
+#include <algorithm>
+#include <chrono>
+#include <iterator>
 #include <optional>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 #ifndef RATATOSKR_FUNCTIONAL_HPP
 #define RATATOSKR_FUNCTIONAL_HPP
@@ -10,159 +16,691 @@ inline namespace functional {
 template <class T>
 class map_and_filterable;
 
-template <class T>
-class composable;
-
-template <class F, class G = void>
+template <class F>
 class mapping;
 
-template <class F, class G = void>
+template <class F>
 class filtering;
 
-template <class F = void>
+template <class T, class F>
+class scanning;
+
+template <class T, class F>
+class folding;
+
+class taking;
+
+class skipping;
+
+template <class T>
+class chunking;
+
+template <class T, class F>
+class chunk_folding;
+
+template <class T>
+class windowing;
+
+template <class T, class F>
+class window_folding;
+
+template <class... Stages>
 class thunk;
 
 template <class T>
-class map_and_filterable {
+class applicable;
+
+template <class E, class = void>
+struct is_executor : std::false_type {};
+
+template <class E>
+struct is_executor<
+    E, std::void_t<decltype(std::declval<E &>().size()),
+                   decltype(std::declval<E &>().bulk(
+                       std::size_t{}, std::declval<void (&)(std::size_t)>()))>>
+    : std::true_type {};
+
+template <class E>
+inline constexpr bool is_executor_v = is_executor<std::decay_t<E>>::value;
+
+template <class Stage>
+struct is_elementwise : std::false_type {};
+
+template <class F>
+struct is_elementwise<mapping<F>> : std::true_type {};
+
+template <class F>
+struct is_elementwise<filtering<F>> : std::true_type {};
+
+template <class V, class Next, class Feed>
+constexpr decltype(auto) emit_at_most_once(Next &next, Feed feed) {
+  using result_type = decltype(next(std::declval<V>()));
+  if constexpr (std::is_void_v<result_type>) {
+    feed([&next](auto &&v) { next(std::forward<decltype(v)>(v)); });
+  }
+  else {
+    result_type r{};
+    feed([&next, &r](auto &&v) { r = next(std::forward<decltype(v)>(v)); });
+    return r;
+  }
+}
+
+template <class F>
+class mapping {
+  F f;
+
 public:
-  template <class F>
-  constexpr auto map(F &&f) const {
-    return static_cast<const T *>(this)->compose(mapping{std::forward<F>(f)});
-  };
+  constexpr explicit mapping(const F &f_) : f(f_) {}
+  constexpr explicit mapping(F &&f_) : f(std::move(f_)) {}
 
-  template <class F>
-  constexpr auto filter(F &&f) const {
-    return static_cast<const T *>(this)->compose(filtering{std::forward<F>(f)});
+  template <class T, class Next>
+  constexpr decltype(auto) operator()(T &&x, Next &&next) {
+    return next(f(std::forward<T>(x)));
   }
+
+  template <class Next>
+  constexpr void flush(Next &&) {}
 };
 
-template <template <class, class> class Composable, class F, class G>
-class composable<Composable<F, G>>
-    : public map_and_filterable<composable<Composable<F, G>>> {
-protected:
+template <class F>
+class filtering {
   F f;
-  G g;
 
 public:
-  constexpr composable(const F &f_, const G &g_) : f(f_), g(g_) {}
-  constexpr composable(const F &f_, G &&g_) : f(f_), g(std::move(g_)) {}
-  constexpr composable(F &&f_, G &&g_) : f(std::move(f_)), g(std::move(g_)) {}
-  constexpr composable(F &&f_, const G &g_) : f(std::move(f_)), g(g_) {}
+  constexpr explicit filtering(const F &f_) : f(f_) {}
+  constexpr explicit filtering(F &&f_) : f(std::move(f_)) {}
+
+  template <class T, class Next>
+  constexpr decltype(auto) operator()(T &&x, Next &&next) {
+    using result_type = decltype(next(std::forward<T>(x)));
+    if constexpr (std::is_void_v<result_type>) {
+      if (f(x)) {
+        next(std::forward<T>(x));
+      }
+    }
+    else {
+      return f(x) ? next(std::forward<T>(x)) : result_type{};
+    }
+  }
 
-  template <class H>
-  constexpr auto compose(H &&h) const {
-    return Composable{f, g.compose(std::forward<H>(h))};
+  template <class Next>
+  constexpr void flush(Next &&) {}
+};
+
+template <class T, class F>
+class scanning {
+  T acc;
+  F f;
+
+public:
+  constexpr scanning(T init, F f_) : acc(std::move(init)), f(std::move(f_)) {}
+
+  template <class U, class Next>
+  constexpr decltype(auto) operator()(U &&x, Next &&next) {
+    acc = f(std::move(acc), std::forward<U>(x));
+    return next(std::as_const(acc));
   }
+
+  template <class Next>
+  constexpr void flush(Next &&) {}
 };
 
-template <template <class, class> class Composable, class F>
-class composable<Composable<F, void>>
-    : public map_and_filterable<composable<Composable<F, void>>> {
-protected:
+template <class T, class F>
+class folding {
+  T init;
+  T acc;
   F f;
 
 public:
-  constexpr composable(const F &f_) : f(f_) {}
-  constexpr composable(F &&f_) : f(std::move(f_)) {}
+  constexpr folding(T init_, F f_)
+      : init(init_), acc(std::move(init_)), f(std::move(f_)) {}
 
-  template <class G>
-  constexpr auto compose(G &&g) const {
-    return Composable{f, std::forward<G>(g)};
+  template <class U, class Next>
+  constexpr decltype(auto) operator()(U &&x, Next &&next) {
+    acc = f(std::move(acc), std::forward<U>(x));
+    return emit_at_most_once<T>(next, [](auto) {});
+  }
+
+  template <class Next>
+  constexpr void flush(Next &&next) {
+    next(std::exchange(acc, init));
   }
 };
 
-template <class F, class G>
-class mapping : public composable<mapping<F, G>> {
+class taking {
+  std::size_t n;
+  std::size_t count;
+
 public:
-  using composable<mapping<F, G>>::composable;
+  constexpr explicit taking(std::size_t n) : n(n), count(0) {}
+
+  template <class U, class Next>
+  constexpr decltype(auto) operator()(U &&x, Next &&next) {
+    return emit_at_most_once<U>(next, [this, &x](auto emit) {
+      if (count < n) {
+        ++count;
+        emit(std::forward<U>(x));
+      }
+    });
+  }
 
-  template <class T>
-  constexpr decltype(auto) operator()(T &&x) {
-    return this->g(this->f(std::forward<T>(x)));
+  template <class Next>
+  constexpr void flush(Next &&) {}
+};
+
+class skipping {
+  std::size_t n;
+  std::size_t count;
+
+public:
+  constexpr explicit skipping(std::size_t n) : n(n), count(0) {}
+
+  template <class U, class Next>
+  constexpr decltype(auto) operator()(U &&x, Next &&next) {
+    return emit_at_most_once<U>(next, [this, &x](auto emit) {
+      if (count < n) {
+        ++count;
+      }
+      else {
+        emit(std::forward<U>(x));
+      }
+    });
   }
+
+  template <class Next>
+  constexpr void flush(Next &&) {}
 };
 
-template <class F>
-class mapping<F, void> : public composable<mapping<F, void>> {
+template <class T>
+class chunking {
+  std::size_t n;
+  std::vector<T> buffer;
+
+  template <class Emit>
+  void emit_buffer(Emit &emit) {
+    emit(std::move(buffer));
+    buffer.clear();
+    buffer.reserve(n);
+  }
+
 public:
-  using composable<mapping<F, void>>::composable;
+  explicit chunking(std::size_t n) : n(n) { buffer.reserve(n); }
+
+  template <class U, class Next>
+  decltype(auto) operator()(U &&x, Next &&next) {
+    return emit_at_most_once<std::vector<T>>(next, [this, &x](auto emit) {
+      buffer.push_back(std::forward<U>(x));
+      if (buffer.size() >= n) {
+        emit_buffer(emit);
+      }
+    });
+  }
 
-  template <class T>
-  constexpr auto operator()(T &&x) {
-    return std::optional{this->f(std::forward<T>(x))};
+  template <class Next>
+  void flush(Next &&next) {
+    if (!buffer.empty()) {
+      emit_buffer(next);
+    }
   }
 };
 
-template <class F, class G>
-mapping(F, G)->mapping<F, G>;
+template <class T, class F>
+class chunk_folding {
+  std::size_t n;
+  std::size_t count;
+  T init;
+  T acc;
+  F f;
 
-template <class F>
-mapping(F)->mapping<F, void>;
+public:
+  constexpr chunk_folding(std::size_t n, T init_, F f_)
+      : n(n), count(0), init(init_), acc(std::move(init_)),
+        f(std::move(f_)) {}
+
+  template <class U, class Next>
+  constexpr decltype(auto) operator()(U &&x, Next &&next) {
+    return emit_at_most_once<T>(next, [this, &x](auto emit) {
+      acc = f(std::move(acc), std::forward<U>(x));
+      if (++count >= n) {
+        count = 0;
+        emit(std::exchange(acc, init));
+      }
+    });
+  }
+
+  template <class Next>
+  constexpr void flush(Next &&next) {
+    if (count != 0) {
+      count = 0;
+      next(std::exchange(acc, init));
+    }
+  }
+};
+
+template <class T>
+class windowing {
+  using clock_type = std::chrono::steady_clock;
+
+  clock_type::duration d;
+  clock_type::time_point end;
+  bool is_open;
+  std::vector<T> buffer;
 
-template <class F, class G>
-class filtering : public composable<filtering<F, G>> {
 public:
-  using composable<filtering<F, G>>::composable;
+  template <class Rep, class Period>
+  explicit windowing(const std::chrono::duration<Rep, Period> &d)
+      : d(std::chrono::duration_cast<clock_type::duration>(d)),
+        is_open(false) {}
+
+  template <class U, class Next>
+  decltype(auto) operator()(U &&x, Next &&next) {
+    return emit_at_most_once<std::vector<T>>(next, [this, &x](auto emit) {
+      auto now = clock_type::now();
+      if (is_open && now >= end) {
+        emit(std::move(buffer));
+        buffer.clear();
+        is_open = false;
+      }
+      if (!is_open) {
+        end = now + d;
+        is_open = true;
+      }
+      buffer.push_back(std::forward<U>(x));
+    });
+  }
 
-  template <class T>
-  constexpr decltype(auto) operator()(T &&x) {
-    return this->f(x) ? this->g(std::forward<T>(x)) : std::nullopt;
+  template <class Next>
+  void flush(Next &&next) {
+    if (is_open) {
+      next(std::move(buffer));
+      buffer.clear();
+      is_open = false;
+    }
   }
 };
 
-template <class F>
-class filtering<F, void> : public composable<filtering<F, void>> {
+template <class T, class F>
+class window_folding {
+  using clock_type = std::chrono::steady_clock;
+
+  clock_type::duration d;
+  clock_type::time_point end;
+  bool is_open;
+  T init;
+  T acc;
+  F f;
+
 public:
-  using composable<filtering<F, void>>::composable;
+  template <class Rep, class Period>
+  window_folding(const std::chrono::duration<Rep, Period> &d, T init_, F f_)
+      : d(std::chrono::duration_cast<clock_type::duration>(d)),
+        is_open(false), init(init_), acc(std::move(init_)),
+        f(std::move(f_)) {}
+
+  template <class U, class Next>
+  decltype(auto) operator()(U &&x, Next &&next) {
+    return emit_at_most_once<T>(next, [this, &x](auto emit) {
+      auto now = clock_type::now();
+      if (is_open && now >= end) {
+        emit(std::exchange(acc, init));
+        is_open = false;
+      }
+      if (!is_open) {
+        end = now + d;
+        is_open = true;
+      }
+      acc = f(std::move(acc), std::forward<U>(x));
+    });
+  }
 
-  template <class T>
-  constexpr auto operator()(T &&x) {
-    return this->f(x) ? std::optional{std::forward<T>(x)} : std::nullopt;
+  template <class Next>
+  void flush(Next &&next) {
+    if (is_open) {
+      next(std::exchange(acc, init));
+      is_open = false;
+    }
   }
 };
 
-template <class F, class G>
-filtering(F, G)->filtering<F, G>;
+template <class T>
+class map_and_filterable {
+public:
+  template <class F>
+  constexpr auto map(F &&f) const & {
+    return static_cast<const T &>(*this).compose(
+        mapping<std::decay_t<F>>{std::forward<F>(f)});
+  }
+  template <class F>
+  constexpr auto map(F &&f) && {
+    return static_cast<T &&>(*this).compose(
+        mapping<std::decay_t<F>>{std::forward<F>(f)});
+  }
 
-template <class F>
-filtering(F)->filtering<F, void>;
+  template <class F>
+  constexpr auto filter(F &&f) const & {
+    return static_cast<const T &>(*this).compose(
+        filtering<std::decay_t<F>>{std::forward<F>(f)});
+  }
+  template <class F>
+  constexpr auto filter(F &&f) && {
+    return static_cast<T &&>(*this).compose(
+        filtering<std::decay_t<F>>{std::forward<F>(f)});
+  }
 
-template <class F>
-class thunk : public map_and_filterable<thunk<F>> {
-  F f;
+  template <class U, class F>
+  constexpr auto scan(U &&init, F &&f) const & {
+    return static_cast<const T &>(*this).compose(
+        scanning<std::decay_t<U>, std::decay_t<F>>{std::forward<U>(init),
+                                                   std::forward<F>(f)});
+  }
+  template <class U, class F>
+  constexpr auto scan(U &&init, F &&f) && {
+    return static_cast<T &&>(*this).compose(
+        scanning<std::decay_t<U>, std::decay_t<F>>{std::forward<U>(init),
+                                                   std::forward<F>(f)});
+  }
+
+  template <class U, class F>
+  constexpr auto fold(U &&init, F &&f) const & {
+    return static_cast<const T &>(*this).compose(
+        folding<std::decay_t<U>, std::decay_t<F>>{std::forward<U>(init),
+                                                  std::forward<F>(f)});
+  }
+  template <class U, class F>
+  constexpr auto fold(U &&init, F &&f) && {
+    return static_cast<T &&>(*this).compose(
+        folding<std::decay_t<U>, std::decay_t<F>>{std::forward<U>(init),
+                                                  std::forward<F>(f)});
+  }
+
+  constexpr auto take(std::size_t n) const & {
+    return static_cast<const T &>(*this).compose(taking{n});
+  }
+  constexpr auto take(std::size_t n) && {
+    return static_cast<T &&>(*this).compose(taking{n});
+  }
+
+  constexpr auto skip(std::size_t n) const & {
+    return static_cast<const T &>(*this).compose(skipping{n});
+  }
+  constexpr auto skip(std::size_t n) && {
+    return static_cast<T &&>(*this).compose(skipping{n});
+  }
+
+  template <class U>
+  auto chunk(std::size_t n) const & {
+    return static_cast<const T &>(*this).compose(chunking<U>{n});
+  }
+  template <class U>
+  auto chunk(std::size_t n) && {
+    return static_cast<T &&>(*this).compose(chunking<U>{n});
+  }
+
+  template <class U, class F>
+  constexpr auto chunk(std::size_t n, U &&init, F &&f) const & {
+    return static_cast<const T &>(*this).compose(
+        chunk_folding<std::decay_t<U>, std::decay_t<F>>{
+            n, std::forward<U>(init), std::forward<F>(f)});
+  }
+  template <class U, class F>
+  constexpr auto chunk(std::size_t n, U &&init, F &&f) && {
+    return static_cast<T &&>(*this).compose(
+        chunk_folding<std::decay_t<U>, std::decay_t<F>>{
+            n, std::forward<U>(init), std::forward<F>(f)});
+  }
+
+  template <class U, class Rep, class Period>
+  auto window(const std::chrono::duration<Rep, Period> &d) const & {
+    return static_cast<const T &>(*this).compose(windowing<U>{d});
+  }
+  template <class U, class Rep, class Period>
+  auto window(const std::chrono::duration<Rep, Period> &d) && {
+    return static_cast<T &&>(*this).compose(windowing<U>{d});
+  }
+
+  template <class Rep, class Period, class U, class F>
+  auto window(const std::chrono::duration<Rep, Period> &d, U &&init,
+              F &&f) const & {
+    return static_cast<const T &>(*this).compose(
+        window_folding<std::decay_t<U>, std::decay_t<F>>{
+            d, std::forward<U>(init), std::forward<F>(f)});
+  }
+  template <class Rep, class Period, class U, class F>
+  auto window(const std::chrono::duration<Rep, Period> &d, U &&init,
+              F &&f) && {
+    return static_cast<T &&>(*this).compose(
+        window_folding<std::decay_t<U>, std::decay_t<F>>{
+            d, std::forward<U>(init), std::forward<F>(f)});
+  }
+};
+
+template <class T>
+class applicable {
+  static constexpr std::size_t grain_size = 4096;
+
+  template <class It>
+  using category_t = typename std::iterator_traits<It>::iterator_category;
+
+  template <class It>
+  static constexpr bool is_random_access_v =
+      std::is_base_of_v<std::random_access_iterator_tag, category_t<It>>;
 
 public:
-  constexpr thunk(const F &f_) : f(f_) {}
-  constexpr thunk(F &&f_) : f(std::move(f_)) {}
+  template <class InputIt, class OutputIt,
+            std::enable_if_t<!is_executor_v<InputIt>, int> = 0>
+  constexpr OutputIt apply(InputIt first, InputIt last, OutputIt out) {
+    auto &self = *static_cast<T *>(this);
+    auto sink = [&out](auto &&y) {
+      *out = std::forward<decltype(y)>(y);
+      ++out;
+    };
+    for (; first != last; ++first) {
+      self(*first, sink);
+    }
+    self.flush(sink);
+    return out;
+  }
 
-  template <class T>
-  constexpr auto operator()(T &&x) {
-    return f(std::forward<T>(x));
+  template <class Range, class OutputIt>
+  constexpr OutputIt apply(Range &&range, OutputIt out) {
+    using std::begin;
+    using std::end;
+    return apply(begin(range), end(range), out);
   }
 
-  template <class G>
-  constexpr auto compose(G &&g) const {
-    return functional::thunk{f.compose(std::forward<G>(g))};
+  template <class Executor, class RandomIt, class OutputIt>
+  OutputIt apply(Executor &ex, RandomIt first, RandomIt last, OutputIt out) {
+    static_assert(is_random_access_v<RandomIt>);
+    using value_type =
+        typename decltype(std::declval<T &>()(*first))::value_type;
+
+    auto n = static_cast<std::size_t>(last - first);
+    auto chunks = (n + grain_size - 1) / grain_size;
+    if (chunks > ex.size() * 4) {
+      chunks = ex.size() * 4;
+    }
+    if (!T::is_elementwise_v || chunks <= 1) {
+      return apply(first, last, out);
+    }
+
+    std::vector<std::vector<value_type>> results(chunks);
+    ex.bulk(chunks, [&](std::size_t i) {
+      auto t = *static_cast<const T *>(this);
+      t.apply(first + n * i / chunks, first + n * (i + 1) / chunks,
+              std::back_inserter(results[i]));
+    });
+
+    std::vector<std::size_t> offsets(chunks + 1, 0);
+    for (std::size_t i = 0; i < chunks; ++i) {
+      offsets[i + 1] = offsets[i] + results[i].size();
+    }
+    if constexpr (is_random_access_v<OutputIt>) {
+      ex.bulk(chunks, [&](std::size_t i) {
+        std::move(results[i].begin(), results[i].end(),
+                  out + static_cast<std::ptrdiff_t>(offsets[i]));
+      });
+      return out + static_cast<std::ptrdiff_t>(offsets[chunks]);
+    }
+    else {
+      for (auto &&r : results) {
+        out = std::move(r.begin(), r.end(), out);
+      }
+      return out;
+    }
   }
+
+  template <class Executor, class Range, class OutputIt,
+            std::enable_if_t<is_executor_v<Executor>, int> = 0>
+  OutputIt apply(Executor &ex, Range &&range, OutputIt out) {
+    using std::begin;
+    using std::end;
+    return apply(ex, begin(range), end(range), out);
+  }
+};
+
+template <std::size_t I, class F>
+struct stage {
+  F f;
 };
 
-template <>
-class thunk<void> : public map_and_filterable<thunk<void>> {
+template <class Indices, class... Stages>
+struct stage_list;
+
+template <std::size_t... I, class... Stages>
+struct stage_list<std::index_sequence<I...>, Stages...>
+    : stage<I, Stages>... {};
+
+template <class... Stages>
+class thunk : public map_and_filterable<thunk<Stages...>>,
+              public applicable<thunk<Stages...>> {
+  template <class... Stages_>
+  friend class thunk;
+
+  using stages_type =
+      stage_list<std::index_sequence_for<Stages...>, Stages...>;
+
+  stages_type stages;
+
+  template <std::size_t I, class F>
+  static constexpr F &get(stage<I, F> &s) {
+    return s.f;
+  }
+  template <std::size_t I, class F>
+  static constexpr const F &get(const stage<I, F> &s) {
+    return s.f;
+  }
+  template <std::size_t I, class F>
+  static constexpr F &&get(stage<I, F> &&s) {
+    return std::move(s.f);
+  }
+
+  template <std::size_t I, class T, class Last>
+  constexpr decltype(auto) run(T &&x, Last &last) {
+    if constexpr (I == sizeof...(Stages)) {
+      return last(std::forward<T>(x));
+    }
+    else {
+      return get<I>(stages)(
+          std::forward<T>(x), [this, &last](auto &&y) -> decltype(auto) {
+            return run<I + 1>(std::forward<decltype(y)>(y), last);
+          });
+    }
+  }
+
+  template <std::size_t I, class Last>
+  constexpr void flush_from(Last &last) {
+    if constexpr (I < sizeof...(Stages)) {
+      get<I>(stages).flush([this, &last](auto &&y) {
+        run<I + 1>(std::forward<decltype(y)>(y), last);
+      });
+      flush_from<I + 1>(last);
+    }
+  }
+
+  template <class List, class G, std::size_t... I>
+  static constexpr auto append(List &&l, G &&g, std::index_sequence<I...>) {
+    using result_type = thunk<Stages..., std::decay_t<G>>;
+    return result_type{typename result_type::stages_type{
+        stage<I, Stages>{get<I>(std::forward<List>(l))}...,
+        stage<sizeof...(Stages), std::decay_t<G>>{std::forward<G>(g)}}};
+  }
+
+  constexpr explicit thunk(stages_type &&stages_)
+      : stages(std::move(stages_)) {}
+
 public:
+  static constexpr bool is_elementwise_v =
+      (is_elementwise<Stages>::value && ...);
+
   constexpr thunk() {}
 
   template <class T>
   constexpr auto operator()(T &&x) {
-    return f(std::forward<T>(x));
+    auto last = [](auto &&y) {
+      return std::optional<std::decay_t<decltype(y)>>{
+          std::forward<decltype(y)>(y)};
+    };
+    return run<0>(std::forward<T>(x), last);
   }
 
-  template <class F>
-  constexpr auto compose(F &&f) const {
-    return functional::thunk{std::forward<F>(f)};
+  template <class T, class Sink>
+  constexpr void operator()(T &&x, Sink &&sink) {
+    auto last = [&sink](auto &&y) { sink(std::forward<decltype(y)>(y)); };
+    run<0>(std::forward<T>(x), last);
+  }
+
+  template <class Sink>
+  constexpr void flush(Sink &&sink) {
+    auto last = [&sink](auto &&y) { sink(std::forward<decltype(y)>(y)); };
+    flush_from<0>(last);
+  }
+
+  template <class G>
+  constexpr auto compose(G &&g) const & {
+    return append(stages, std::forward<G>(g),
+                  std::index_sequence_for<Stages...>{});
+  }
+  template <class G>
+  constexpr auto compose(G &&g) && {
+    return append(std::move(stages), std::forward<G>(g),
+                  std::index_sequence_for<Stages...>{});
   }
 };
 
-thunk()->thunk<void>;
+thunk()->thunk<>;
+
+template <class... Stages, class Range>
+auto transform_filter(thunk<Stages...> t, const Range &range) {
+  using std::begin;
+  using std::end;
+  using value_type = typename decltype(t(*begin(range)))::value_type;
+  std::vector<value_type> out;
+  auto first = begin(range);
+  auto last = end(range);
+  if constexpr (thunk<Stages...>::is_elementwise_v &&
+                std::is_trivially_default_constructible_v<value_type> &&
+                std::is_base_of_v<std::random_access_iterator_tag,
+                                  typename std::iterator_traits<
+                                      decltype(first)>::iterator_category>) {
+    out.resize(static_cast<std::size_t>(std::distance(first, last)));
+    out.erase(out.begin() + (t.apply(first, last, out.data()) - out.data()),
+              out.end());
+  }
+  else {
+    t.apply(first, last, std::back_inserter(out));
+  }
+  return out;
+}
+
+template <class Executor, class... Stages, class Range>
+auto transform_filter(Executor &ex, thunk<Stages...> t, const Range &range) {
+  using std::begin;
+  using std::end;
+  using value_type = typename decltype(t(*begin(range)))::value_type;
+  std::vector<value_type> out;
+  t.apply(ex, begin(range), end(range), std::back_inserter(out));
+  return out;
+}
 
 } // namespace functional
 } // namespace rat
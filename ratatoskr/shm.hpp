@@ -0,0 +1,377 @@
+#include "concurrent.hpp"
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <system_error>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+
+#ifndef RATATOSKR_SHM_HPP
+#define RATATOSKR_SHM_HPP
+
+namespace rat {
+inline namespace concurrent {
+
+class futex_word {
+  std::atomic<std::uint32_t> seq;
+  std::atomic<std::uint32_t> waiters;
+
+  static_assert(std::atomic<std::uint32_t>::is_always_lock_free &&
+                    sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t),
+                "A futex needs a plain 32-bit word.");
+
+  void sleep(std::uint32_t s, const timespec *t) {
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&seq), FUTEX_WAIT, s,
+            t, nullptr, 0);
+  }
+
+public:
+  futex_word() : seq(0), waiters(0) {}
+
+  template <class Predicate>
+  void wait(Predicate pred) {
+    while (!pred()) {
+      auto s = seq.load(std::memory_order_acquire);
+      waiters.fetch_add(1, std::memory_order_seq_cst);
+      if (!pred()) {
+        sleep(s, nullptr);
+      }
+      waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+  template <class Clock, class Duration, class Predicate>
+  bool wait_until(const std::chrono::time_point<Clock, Duration> &timeout,
+                  Predicate pred) {
+    while (!pred()) {
+      auto rest = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      timeout - Clock::now())
+                      .count();
+      if (rest <= 0) {
+        return pred();
+      }
+      timespec t{static_cast<std::time_t>(rest / 1000000000),
+                 static_cast<long>(rest % 1000000000)};
+      auto s = seq.load(std::memory_order_acquire);
+      waiters.fetch_add(1, std::memory_order_seq_cst);
+      if (!pred()) {
+        sleep(s, &t);
+      }
+      waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  void notify_one() {
+    seq.fetch_add(1, std::memory_order_seq_cst);
+    if (waiters.load(std::memory_order_seq_cst) != 0) {
+      syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&seq), FUTEX_WAKE,
+              1, nullptr, nullptr, 0);
+    }
+  }
+  void notify_all() {
+    seq.fetch_add(1, std::memory_order_seq_cst);
+    if (waiters.load(std::memory_order_seq_cst) != 0) {
+      syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&seq), FUTEX_WAKE,
+              INT_MAX, nullptr, nullptr, 0);
+    }
+  }
+};
+
+template <class T>
+class shm_queue {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "A shared-memory channel only carries trivially copyable "
+                "values.");
+  static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+                "A shared-memory channel needs lock-free 64-bit atomics.");
+
+  alignas(cache_line_size) std::atomic<std::uint64_t> head;
+  std::uint64_t cached_tail;
+  std::atomic<std::uint64_t> peak;
+  alignas(cache_line_size) std::atomic<std::uint64_t> tail;
+  std::uint64_t cached_head;
+  alignas(cache_line_size) std::uint64_t capacity_v;
+  std::uint64_t mask;
+  std::ptrdiff_t offset;
+
+  T *slot(std::uint64_t i) const {
+    return std::launder(reinterpret_cast<T *>(
+        const_cast<unsigned char *>(
+            reinterpret_cast<const unsigned char *>(this)) +
+        offset + sizeof(T) * (i & mask)));
+  }
+
+  void update_peak(std::uint64_t n) {
+    if (n > peak.load(std::memory_order_relaxed)) {
+      peak.store(n, std::memory_order_relaxed);
+    }
+  }
+
+public:
+  static constexpr bool is_single_producer = true;
+  static constexpr bool is_single_consumer = true;
+  static constexpr bool is_interprocess = true;
+
+  static std::uint64_t round_up(std::uint64_t n) {
+    std::uint64_t size = 1;
+    while (size < n) {
+      size <<= 1;
+    }
+    return size;
+  }
+
+  shm_queue(std::size_t capacity, void *storage)
+      : head(0), cached_tail(0), peak(0), tail(0), cached_head(0),
+        capacity_v(capacity), mask(round_up(capacity) - 1),
+        offset(static_cast<unsigned char *>(storage) -
+               reinterpret_cast<unsigned char *>(this)) {}
+
+  shm_queue(const shm_queue &) = delete;
+  shm_queue &operator=(const shm_queue &) = delete;
+
+  std::size_t capacity() const { return capacity_v; }
+  std::size_t slots() const { return mask + 1; }
+
+  std::size_t size() const {
+    auto h = head.load(std::memory_order_acquire);
+    return static_cast<std::size_t>(tail.load(std::memory_order_acquire) - h);
+  }
+
+  std::size_t high_water() const {
+    return static_cast<std::size_t>(peak.load(std::memory_order_relaxed));
+  }
+
+  bool empty() const {
+    return head.load(std::memory_order_acquire) ==
+           tail.load(std::memory_order_acquire);
+  }
+  bool full() const {
+    return tail.load(std::memory_order_acquire) -
+               head.load(std::memory_order_acquire) ==
+           capacity_v;
+  }
+
+  template <class... Args>
+  bool try_emplace(Args &&... args) {
+    auto t = tail.load(std::memory_order_relaxed);
+    if (t - cached_head == capacity_v) {
+      cached_head = head.load(std::memory_order_acquire);
+      if (t - cached_head == capacity_v) {
+        return false;
+      }
+    }
+    ::new (static_cast<void *>(slot(t))) T(std::forward<Args>(args)...);
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  std::optional<T> try_pop() {
+    auto h = head.load(std::memory_order_relaxed);
+    if (h == cached_tail) {
+      cached_tail = tail.load(std::memory_order_acquire);
+      if (h == cached_tail) {
+        return std::nullopt;
+      }
+      update_peak(cached_tail - h);
+    }
+    std::optional<T> x{*slot(h)};
+    head.store(h + 1, std::memory_order_release);
+    return x;
+  }
+
+  std::optional<T> peek() {
+    auto h = head.load(std::memory_order_relaxed);
+    if (h == cached_tail) {
+      cached_tail = tail.load(std::memory_order_acquire);
+      if (h == cached_tail) {
+        return std::nullopt;
+      }
+      update_peak(cached_tail - h);
+    }
+    return *slot(h);
+  }
+};
+
+template <class T>
+using shm_channel_state = lockfree_channel_state<T, shm_queue<T>, futex_word>;
+
+template <class T>
+class shm_segment {
+  using state_type = shm_channel_state<T>;
+
+  static_assert(std::is_trivially_destructible_v<state_type>,
+                "A shared-memory channel state is never destroyed.");
+
+  static constexpr std::uint32_t magic = 0x52415453;
+
+  struct header {
+    std::atomic<std::uint32_t> ready;
+    std::uint32_t state_size;
+    std::uint32_t value_size;
+  };
+
+  static constexpr std::size_t align(std::size_t n, std::size_t a) {
+    return (n + a - 1) / a * a;
+  }
+
+  static constexpr std::size_t state_offset =
+      align(sizeof(header), alignof(state_type));
+  static constexpr std::size_t data_offset =
+      align(state_offset + sizeof(state_type), alignof(T));
+
+  std::string name;
+  bool is_owner;
+  std::size_t length;
+  header *shared;
+
+  static void *map(int fd, std::size_t length) {
+    auto p = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    auto error = errno;
+    ::close(fd);
+    if (p == MAP_FAILED) {
+      throw std::system_error{error, std::generic_category(),
+                              "shm_segment::shm_segment"};
+    }
+    return p;
+  }
+
+  [[noreturn]] static void fail(int fd) {
+    auto error = errno;
+    if (fd >= 0) {
+      ::close(fd);
+    }
+    throw std::system_error{error, std::generic_category(),
+                            "shm_segment::shm_segment"};
+  }
+
+  unsigned char *base() const {
+    return reinterpret_cast<unsigned char *>(shared);
+  }
+
+public:
+  shm_segment(const std::string &name, std::size_t capacity,
+              overflow_policy policy)
+      : name(name), is_owner(true), length(0), shared(nullptr) {
+    if (capacity == 0 || policy == overflow_policy::drop_oldest) {
+      throw std::invalid_argument{"shm_segment::shm_segment"};
+    }
+    length = data_offset + sizeof(T) * shm_queue<T>::round_up(capacity);
+    auto fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+      fail(fd);
+    }
+    if (ftruncate(fd, static_cast<off_t>(length)) != 0) {
+      shm_unlink(name.c_str());
+      fail(fd);
+    }
+    try {
+      shared = ::new (map(fd, length)) header{};
+    }
+    catch (...) {
+      shm_unlink(name.c_str());
+      throw;
+    }
+    ::new (base() + state_offset)
+        state_type(capacity, policy, base() + data_offset);
+    shared->state_size = sizeof(state_type);
+    shared->value_size = sizeof(T);
+    shared->ready.store(magic, std::memory_order_release);
+  }
+
+  explicit shm_segment(const std::string &name)
+      : name(name), is_owner(false), length(0), shared(nullptr) {
+    auto fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+      fail(fd);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      fail(fd);
+    }
+    length = static_cast<std::size_t>(st.st_size);
+    if (length < data_offset) {
+      ::close(fd);
+      throw std::invalid_argument{"shm_segment::shm_segment"};
+    }
+    shared = static_cast<header *>(map(fd, length));
+    if (shared->ready.load(std::memory_order_acquire) != magic ||
+        shared->state_size != sizeof(state_type) ||
+        shared->value_size != sizeof(T) ||
+        length < data_offset + sizeof(T) * state()->data.slots()) {
+      munmap(shared, length);
+      throw std::invalid_argument{"shm_segment::shm_segment"};
+    }
+  }
+
+  shm_segment(const shm_segment &) = delete;
+  shm_segment &operator=(const shm_segment &) = delete;
+
+  ~shm_segment() {
+    munmap(shared, length);
+    if (is_owner) {
+      shm_unlink(name.c_str());
+    }
+  }
+
+  state_type *state() const {
+    return std::launder(reinterpret_cast<state_type *>(base() + state_offset));
+  }
+};
+
+template <class T>
+class channel<T, shm_channel_state<T>> {
+  using state_type = shm_channel_state<T>;
+
+  std::shared_ptr<state_type> state;
+
+  static std::shared_ptr<state_type>
+  share(const std::shared_ptr<shm_segment<T>> &segment) {
+    return std::shared_ptr<state_type>{segment, segment->state()};
+  }
+
+public:
+  channel(const std::string &name, std::size_t capacity,
+          overflow_policy policy = overflow_policy::block)
+      : state(share(std::make_shared<shm_segment<T>>(name, capacity, policy))) {
+  }
+  explicit channel(const std::string &name)
+      : state(share(std::make_shared<shm_segment<T>>(name))) {}
+
+  sender<T, state_type> get_sender() const {
+    state->claim_sender();
+    return sender<T, state_type>{state};
+  }
+  receiver<T, state_type> get_receiver() const {
+    return receiver<T, state_type>{state};
+  }
+  channel_closer get_closer() const { return channel_closer{state}; }
+
+  std::size_t size() const { return state->size(); }
+  channel_stats stats() const { return state->stats(); }
+
+  void close() { state->close(); }
+  void abort() { state->close(true); }
+};
+
+template <class T>
+using shm_channel = channel<T, shm_channel_state<T>>;
+
+} // namespace concurrent
+} // namespace rat
+#endif
@@ -1,6 +1,652 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
 #ifndef RATATOSKR_SIGNAL_HPP
 #define RATATOSKR_SIGNAL_HPP
 
-namespace ratatoskr::signal {}
+namespace rat {
+inline namespace reactive {
+
+template <class T, std::size_t N>
+class small_vector {
+  alignas(T) unsigned char inline_storage[sizeof(T) * N];
+  T *data_;
+  std::size_t size_v;
+  std::size_t capacity_v;
+
+  T *inline_data() { return reinterpret_cast<T *>(inline_storage); }
+
+  void reallocate(std::size_t n) {
+    auto p = std::allocator<T>{}.allocate(n);
+    for (std::size_t i = 0; i < size_v; ++i) {
+      new (p + i) T(std::move(data_[i]));
+      data_[i].~T();
+    }
+    if (data_ != inline_data()) {
+      std::allocator<T>{}.deallocate(data_, capacity_v);
+    }
+    data_ = p;
+    capacity_v = n;
+  }
+
+public:
+  small_vector() : data_(inline_data()), size_v(0), capacity_v(N) {}
+
+  small_vector(const small_vector &) = delete;
+  small_vector &operator=(const small_vector &) = delete;
+
+  ~small_vector() {
+    clear();
+    if (data_ != inline_data()) {
+      std::allocator<T>{}.deallocate(data_, capacity_v);
+    }
+  }
+
+  bool empty() const { return size_v == 0; }
+  std::size_t size() const { return size_v; }
+  std::size_t capacity() const { return capacity_v; }
+
+  T &operator[](std::size_t i) { return data_[i]; }
+  const T &operator[](std::size_t i) const { return data_[i]; }
+
+  T *begin() { return data_; }
+  T *end() { return data_ + size_v; }
+  const T *begin() const { return data_; }
+  const T *end() const { return data_ + size_v; }
+
+  template <class... Args>
+  T &emplace_back(Args &&... args) {
+    if (size_v == capacity_v) {
+      reallocate(capacity_v * 2);
+    }
+    auto p = new (data_ + size_v) T(std::forward<Args>(args)...);
+    ++size_v;
+    return *p;
+  }
+
+  template <class Predicate>
+  void erase_if(Predicate pred) {
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < size_v; ++i) {
+      if (pred(data_[i])) {
+        data_[i].~T();
+      }
+      else {
+        if (n != i) {
+          new (data_ + n) T(std::move(data_[i]));
+          data_[i].~T();
+        }
+        ++n;
+      }
+    }
+    size_v = n;
+  }
+
+  void clear() {
+    for (std::size_t i = 0; i < size_v; ++i) {
+      data_[i].~T();
+    }
+    size_v = 0;
+  }
+};
+
+template <class T>
+class slot {
+  enum class operation { move, destroy };
+
+  static constexpr std::size_t buffer_size = sizeof(void *) * 3;
+
+  template <class F>
+  static constexpr bool is_inline_v =
+      sizeof(F) <= buffer_size && alignof(F) <= alignof(std::max_align_t) &&
+      std::is_nothrow_move_constructible_v<F>;
+
+  template <class F>
+  static F *target(void *buffer) {
+    if constexpr (is_inline_v<F>) {
+      return std::launder(reinterpret_cast<F *>(buffer));
+    }
+    else {
+      return *std::launder(reinterpret_cast<F **>(buffer));
+    }
+  }
+
+  alignas(std::max_align_t) unsigned char buffer[buffer_size];
+  void (*invoke_f)(void *, const T &);
+  void (*manage_f)(operation, void *, void *);
+  std::uint64_t generation_v;
+
+public:
+  template <class F>
+  slot(F &&f, std::uint64_t generation) : generation_v(generation) {
+    using G = std::decay_t<F>;
+    if constexpr (is_inline_v<G>) {
+      new (buffer) G(std::forward<F>(f));
+    }
+    else {
+      new (buffer) G *(new G(std::forward<F>(f)));
+    }
+    invoke_f = [](void *buffer, const T &x) { (*target<G>(buffer))(x); };
+    manage_f = [](operation op, void *dst, void *src) {
+      if constexpr (is_inline_v<G>) {
+        if (op == operation::move) {
+          new (dst) G(std::move(*target<G>(src)));
+        }
+        target<G>(src)->~G();
+      }
+      else {
+        if (op == operation::move) {
+          new (dst) G *(target<G>(src));
+        }
+        else {
+          delete target<G>(src);
+        }
+      }
+    };
+  }
+
+  slot(slot &&other) noexcept
+      : invoke_f(other.invoke_f), manage_f(other.manage_f),
+        generation_v(other.generation_v) {
+    manage_f(operation::move, buffer, other.buffer);
+    other.manage_f = nullptr;
+  }
+
+  slot(const slot &) = delete;
+  slot &operator=(const slot &) = delete;
+
+  ~slot() {
+    if (manage_f != nullptr) {
+      manage_f(operation::destroy, nullptr, buffer);
+    }
+  }
+
+  std::uint64_t generation() const { return generation_v; }
+  bool connected() const { return invoke_f != nullptr; }
+  void disconnect() { invoke_f = nullptr; }
+
+  void operator()(const T &x) { invoke_f(buffer, x); }
+};
+
+class connection {
+  template <class T>
+  friend class signal;
+
+  std::weak_ptr<void> core;
+  void (*disconnect_f)(void *, std::uint64_t);
+  bool (*connected_f)(void *, std::uint64_t);
+  std::uint64_t generation;
+
+  template <class Core>
+  connection(const std::shared_ptr<Core> &core, std::uint64_t generation)
+      : core(core), disconnect_f(&Core::disconnect_slot),
+        connected_f(&Core::is_connected_slot), generation(generation) {}
+
+public:
+  connection()
+      : disconnect_f(nullptr), connected_f(nullptr), generation(0) {}
+
+  void disconnect() const {
+    if (auto c = core.lock()) {
+      disconnect_f(c.get(), generation);
+    }
+  }
+
+  bool connected() const {
+    auto c = core.lock();
+    return c != nullptr && connected_f(c.get(), generation);
+  }
+};
+
+class scoped_connection {
+  connection c;
+
+public:
+  scoped_connection() {}
+  scoped_connection(const connection &c) : c(c) {}
+
+  scoped_connection(const scoped_connection &) = delete;
+  scoped_connection &operator=(const scoped_connection &) = delete;
+  scoped_connection(scoped_connection &&other) : c(other.release()) {}
+  scoped_connection &operator=(scoped_connection &&other) {
+    c.disconnect();
+    c = other.release();
+    return *this;
+  }
+
+  ~scoped_connection() { c.disconnect(); }
+
+  connection release() { return std::exchange(c, connection{}); }
+
+  void disconnect() const { c.disconnect(); }
+  bool connected() const { return c.connected(); }
+};
+
+template <class T>
+class signal {
+  struct core {
+    small_vector<slot<T>, 4> slots;
+    std::vector<slot<T>> pending;
+    std::uint64_t next_generation = 0;
+    std::size_t emitting = 0;
+    bool has_disconnected = false;
+
+    slot<T> *find(std::uint64_t generation) {
+      for (auto &&s : slots) {
+        if (s.generation() == generation) {
+          return &s;
+        }
+      }
+      for (auto &&s : pending) {
+        if (s.generation() == generation) {
+          return &s;
+        }
+      }
+      return nullptr;
+    }
+
+    void collect() {
+      if (has_disconnected) {
+        slots.erase_if([](const slot<T> &s) { return !s.connected(); });
+        has_disconnected = false;
+      }
+      for (auto &&s : pending) {
+        if (s.connected()) {
+          slots.emplace_back(std::move(s));
+        }
+      }
+      pending.clear();
+    }
+
+    static void disconnect_slot(void *p, std::uint64_t generation) {
+      auto c = static_cast<core *>(p);
+      if (auto s = c->find(generation); s != nullptr && s->connected()) {
+        s->disconnect();
+        c->has_disconnected = true;
+        if (c->emitting == 0) {
+          c->collect();
+        }
+      }
+    }
+
+    static bool is_connected_slot(void *p, std::uint64_t generation) {
+      auto s = static_cast<core *>(p)->find(generation);
+      return s != nullptr && s->connected();
+    }
+  };
+
+  class emit_guard {
+    core &c;
+
+  public:
+    explicit emit_guard(core &c) : c(c) { ++c.emitting; }
+    ~emit_guard() {
+      if (--c.emitting == 0 && (c.has_disconnected || !c.pending.empty())) {
+        c.collect();
+      }
+    }
+  };
+
+  std::shared_ptr<core> state;
+
+public:
+  signal() : state(std::make_shared<core>()) {}
+
+  signal(const signal &) = delete;
+  signal &operator=(const signal &) = delete;
+  signal(signal &&) = default;
+  signal &operator=(signal &&) = default;
+
+  template <class F>
+  connection connect(F &&f) {
+    auto generation = ++state->next_generation;
+    if (state->emitting == 0) {
+      state->slots.emplace_back(std::forward<F>(f), generation);
+    }
+    else {
+      state->pending.emplace_back(std::forward<F>(f), generation);
+    }
+    return connection{state, generation};
+  }
+
+  template <class G, class F>
+  connection connect(G &&g, F &&f) {
+    return connect([g = std::forward<G>(g), f = std::forward<F>(f)](
+                       const T &x) mutable { g(x, f); });
+  }
+
+  void emit(const T &x) {
+    emit_guard guard{*state};
+    auto &slots = state->slots;
+    auto n = slots.size();
+    for (std::size_t i = 0; i < n; ++i) {
+      if (slots[i].connected()) {
+        slots[i](x);
+      }
+    }
+  }
+
+  void operator()(const T &x) { emit(x); }
+
+  std::size_t size() const {
+    std::size_t n = 0;
+    for (auto &&s : state->slots) {
+      n += s.connected();
+    }
+    for (auto &&s : state->pending) {
+      n += s.connected();
+    }
+    return n;
+  }
+
+  bool empty() const { return size() == 0; }
+
+  void disconnect_all() {
+    for (auto &&s : state->slots) {
+      s.disconnect();
+    }
+    for (auto &&s : state->pending) {
+      s.disconnect();
+    }
+    state->has_disconnected = true;
+    if (state->emitting == 0) {
+      state->collect();
+    }
+  }
+};
+
+template <class T, class = void>
+struct is_equality_comparable : std::false_type {};
+
+template <class T>
+struct is_equality_comparable<
+    T, std::void_t<decltype(std::declval<const T &>() ==
+                            std::declval<const T &>())>> : std::true_type {};
+
+class reactive_node {
+  enum class state_type { clean, check, dirty };
+
+  struct propagation {
+    std::size_t depth = 0;
+    std::vector<reactive_node *> queue;
+  };
+
+  static propagation &current() {
+    static thread_local propagation p;
+    return p;
+  }
+
+  static bool higher(const reactive_node *a, const reactive_node *b) {
+    return a->height_v > b->height_v;
+  }
+
+  small_vector<reactive_node *, 4> dependents;
+  std::size_t height_v;
+  state_type state;
+  bool is_queued;
+
+  void mark(state_type s) {
+    if (state >= s) {
+      return;
+    }
+    auto was_clean = state == state_type::clean;
+    state = s;
+    if (was_clean) {
+      enqueue();
+      for (auto &&d : dependents) {
+        d->mark(state_type::check);
+      }
+    }
+  }
+
+protected:
+  explicit reactive_node(std::size_t height)
+      : height_v(height),
+        state(height == 0 ? state_type::clean : state_type::dirty),
+        is_queued(false) {}
+
+  ~reactive_node() {
+    if (is_queued) {
+      auto &q = current().queue;
+      q.erase(std::remove(q.begin(), q.end(), this), q.end());
+      std::make_heap(q.begin(), q.end(), &higher);
+    }
+  }
+
+  void depend_on(reactive_node &input) { input.dependents.emplace_back(this); }
+
+  void forget(reactive_node &input) {
+    input.dependents.erase_if([this](reactive_node *d) { return d == this; });
+  }
+
+  bool is_dirty() const { return state == state_type::dirty; }
+  bool is_clean() const { return state == state_type::clean; }
+  void clean() { state = state_type::clean; }
+
+  void mark_dependents() {
+    for (auto &&d : dependents) {
+      d->mark(state_type::dirty);
+    }
+  }
+
+  void enqueue() {
+    if (!is_queued && is_observed()) {
+      is_queued = true;
+      auto &q = current().queue;
+      q.push_back(this);
+      std::push_heap(q.begin(), q.end(), &higher);
+    }
+  }
+
+  virtual bool is_observed() const = 0;
+  virtual void flush() = 0;
+
+public:
+  reactive_node(const reactive_node &) = delete;
+  reactive_node &operator=(const reactive_node &) = delete;
+
+  virtual void update() = 0;
+
+  std::size_t height() const { return height_v; }
+
+  static void begin_batch() { ++current().depth; }
+
+  static void end_batch() {
+    auto &p = current();
+    if (--p.depth != 0) {
+      return;
+    }
+    struct flushing {
+      propagation &p;
+      explicit flushing(propagation &p) : p(p) { ++p.depth; }
+      ~flushing() { --p.depth; }
+    } f{p};
+    while (!p.queue.empty()) {
+      std::pop_heap(p.queue.begin(), p.queue.end(), &higher);
+      auto n = p.queue.back();
+      p.queue.pop_back();
+      n->is_queued = false;
+      n->flush();
+    }
+  }
+};
+
+template <class T>
+class observable_node : public reactive_node {
+  std::optional<T> value_v;
+  signal<T> changed_signal;
+  bool is_changed;
+
+  bool is_observed() const override { return !changed_signal.empty(); }
+
+  void flush() override {
+    update();
+    if (is_changed) {
+      is_changed = false;
+      changed_signal.emit(*value_v);
+    }
+  }
+
+protected:
+  explicit observable_node(std::size_t height)
+      : reactive_node(height), is_changed(false) {}
+
+  template <class U>
+  observable_node(std::size_t height, U &&x)
+      : reactive_node(height), value_v(std::forward<U>(x)), is_changed(false) {}
+
+  template <class U>
+  void assign(U &&x) {
+    if constexpr (is_equality_comparable<T>::value) {
+      if (value_v && *value_v == x) {
+        return;
+      }
+    }
+    value_v = std::forward<U>(x);
+    is_changed = true;
+    mark_dependents();
+  }
+
+public:
+  const T &get() {
+    update();
+    return *value_v;
+  }
+
+  template <class F>
+  connection observe(F &&f) {
+    update();
+    is_changed = false;
+    return changed_signal.connect(std::forward<F>(f));
+  }
+};
+
+template <class T>
+class value_node : public observable_node<T> {
+public:
+  template <class U>
+  explicit value_node(U &&x) : observable_node<T>(0, std::forward<U>(x)) {}
+
+  void update() override {}
+
+  template <class U>
+  void set(U &&x) {
+    reactive_node::begin_batch();
+    this->assign(std::forward<U>(x));
+    this->enqueue();
+    reactive_node::end_batch();
+  }
+};
+
+template <class T, class F, class... Inputs>
+class computed_node : public observable_node<T> {
+  F f;
+  std::tuple<std::shared_ptr<observable_node<Inputs>>...> inputs;
+
+public:
+  computed_node(F &&f, std::shared_ptr<observable_node<Inputs>>... inputs)
+      : observable_node<T>(std::max({inputs->height()...}) + 1),
+        f(std::move(f)), inputs(std::move(inputs)...) {
+    std::apply([this](auto &... in) { (this->depend_on(*in), ...); },
+               this->inputs);
+  }
+
+  ~computed_node() {
+    std::apply([this](auto &... in) { (this->forget(*in), ...); }, inputs);
+  }
+
+  void update() override {
+    if (this->is_clean()) {
+      return;
+    }
+    if (!this->is_dirty()) {
+      std::apply(
+          [this](auto &... in) {
+            ((this->is_dirty() ? void() : in->update()), ...);
+          },
+          inputs);
+    }
+    if (this->is_dirty()) {
+      this->assign(std::apply(
+          [this](auto &... in) { return std::invoke(f, in->get()...); },
+          inputs));
+    }
+    this->clean();
+  }
+};
+
+template <class T>
+class computed {
+protected:
+  std::shared_ptr<observable_node<T>> node_v;
+
+public:
+  using value_type = T;
+
+  explicit computed(std::shared_ptr<observable_node<T>> node)
+      : node_v(std::move(node)) {}
+
+  const T &get() const { return node_v->get(); }
+
+  template <class F>
+  connection observe(F &&f) const {
+    return node_v->observe(std::forward<F>(f));
+  }
+
+  const std::shared_ptr<observable_node<T>> &node() const { return node_v; }
+};
+
+template <class T>
+class value : public computed<T> {
+public:
+  template <class U = T,
+            std::enable_if_t<!std::is_same_v<std::decay_t<U>, value>, int> = 0>
+  explicit value(U &&x = U())
+      : computed<T>(std::make_shared<value_node<T>>(std::forward<U>(x))) {}
+
+  template <class U>
+  void set(U &&x) const {
+    static_cast<value_node<T> &>(*this->node_v).set(std::forward<U>(x));
+  }
+};
+
+template <class F>
+void batch(F &&f) {
+  struct guard {
+    guard() { reactive_node::begin_batch(); }
+    ~guard() { reactive_node::end_batch(); }
+  } g;
+  f();
+}
+
+template <class Tuple, std::size_t... I>
+auto combine_inputs(Tuple &&args, std::index_sequence<I...>) {
+  auto &&f = std::get<sizeof...(I)>(args);
+  using F = std::decay_t<decltype(f)>;
+  using R = std::decay_t<decltype(std::invoke(f, std::get<I>(args).get()...))>;
+  return computed<R>{std::make_shared<computed_node<
+      R, F,
+      typename std::decay_t<std::tuple_element_t<I, Tuple>>::value_type...>>(
+      F{f}, std::get<I>(args).node()...)};
+}
+
+template <class... Args>
+auto combine(Args &&... args) {
+  static_assert(sizeof...(Args) >= 2, "combine needs inputs and a function.");
+  return combine_inputs(std::forward_as_tuple(std::forward<Args>(args)...),
+                        std::make_index_sequence<sizeof...(Args) - 1>{});
+}
+
+} // namespace reactive
+} // namespace rat
 
 #endif
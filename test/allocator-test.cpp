@@ -0,0 +1,91 @@
+#include "../ratatoskr/concurrent.hpp"
+#include <cstddef>
+#include <iostream>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class counting_resource : public std::pmr::memory_resource {
+  std::pmr::memory_resource *upstream;
+  std::size_t allocated;
+
+  void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+    allocated += bytes;
+    return upstream->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void *p, std::size_t bytes,
+                     std::size_t alignment) override {
+    upstream->deallocate(p, bytes, alignment);
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource &other) const
+      noexcept override {
+    return this == &other;
+  }
+
+public:
+  explicit counting_resource(std::pmr::memory_resource *upstream)
+      : upstream(upstream), allocated(0) {}
+
+  std::size_t bytes() const { return allocated; }
+};
+
+int main() {
+  using namespace rat::concurrent;
+
+  auto log = [](auto tag, auto x) {
+    static std::mutex io_mutex;
+    std::lock_guard lock{io_mutex};
+    std::cout << tag << ": " << x << " @thread #" << std::this_thread::get_id()
+              << std::endl;
+  };
+
+  std::pmr::monotonic_buffer_resource arena;
+  counting_resource resource{&arena};
+  std::pmr::polymorphic_allocator<int> alloc{&resource};
+
+  {
+    auto [sn, rc] = make_channel<int>(std::allocator_arg, alloc);
+    log("state  ", resource.bytes() != 0 ? "from resource" : "from heap");
+    auto before = resource.bytes();
+    std::thread producer{[sn = std::move(sn)]() mutable {
+      for (int i = 0; i < 100; ++i) {
+        sn.push(i);
+      }
+    }};
+    producer.join();
+    int sum = 0;
+    try {
+      while (true) {
+        sum += rc.next();
+      }
+    }
+    catch (const close_channel &) {
+      log("sum    ", sum);
+    }
+    log("ring   ", resource.bytes() > before ? "from resource" : "from heap");
+  }
+
+  {
+    auto before = resource.bytes();
+    auto [sn, rc] = make_channel<int>(std::allocator_arg, alloc, 16);
+    auto reserved = resource.bytes();
+    log("bounded", reserved > before ? "from resource" : "from heap");
+    for (int i = 0; i < 16; ++i) {
+      sn.push(i);
+    }
+    log("bounded", resource.bytes() == reserved ? "no allocation"
+                                                : "allocated");
+    log("bounded", rc.next());
+  }
+
+  {
+    std::pmr::polymorphic_allocator<std::pmr::string> strings{&resource};
+    auto [sn, rc] = make_channel<std::pmr::string>(
+        std::allocator_arg, strings, with_shared_receiver);
+    sn.push(std::pmr::string{"shared", strings});
+    log("shared ", rc.next());
+  }
+}
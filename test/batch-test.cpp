@@ -0,0 +1,60 @@
+#include "../ratatoskr/concurrent.hpp"
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+int main() {
+  using namespace rat::concurrent;
+
+  auto log = [](auto tag, auto x) {
+    static std::mutex io_mutex;
+    std::lock_guard lock{io_mutex};
+    std::cout << tag << ": " << x << " @thread #" << std::this_thread::get_id()
+              << std::endl;
+  };
+
+  auto join = [](const std::vector<int> &v) {
+    std::string s;
+    for (auto &&x : v) {
+      s += std::to_string(x) + " ";
+    }
+    return s;
+  };
+
+  auto batch = [&log, &join](auto name, auto sn, auto rc) {
+    std::vector<int> first{0, 1, 2, 3, 4};
+    int second[] = {5, 6, 7, 8, 9};
+    log(name, sn.push_bulk(first));
+    log(name, sn.push_range(std::begin(second), std::end(second)));
+
+    std::vector<int> head;
+    log(name, rc.next_n(std::back_inserter(head), 4));
+    log(name, join(head));
+
+    std::vector<int> rest;
+    log(name, rc.try_drain(rest));
+    log(name, join(rest));
+    log(name, rc.try_drain(rest));
+  };
+
+  {
+    auto [sn, rc] = make_channel<int>();
+    batch("mutex  ", std::move(sn), std::move(rc));
+  }
+  {
+    auto [sn, rc] = make_channel<int>(with_single_sender, 16);
+    batch("spsc   ", std::move(sn), std::move(rc));
+  }
+  {
+    auto [sn, rc] = make_channel<int>(with_shared_receiver, 16);
+    batch("mpmc   ", std::move(sn), std::move(rc));
+  }
+  {
+    auto [sn, rc] = make_channel<int>(4, overflow_policy::fail);
+    std::vector<int> values{0, 1, 2, 3, 4, 5};
+    log("full   ", sn.push_bulk(values));
+  }
+}
@@ -0,0 +1,105 @@
+#include "../ratatoskr/concurrent.hpp"
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+int main() {
+  using namespace rat::concurrent;
+  using namespace std::chrono_literals;
+
+  auto log = [](auto tag, auto x) {
+    static std::mutex io_mutex;
+    std::lock_guard lock{io_mutex};
+    std::cout << tag << ": " << x << " @thread #" << std::this_thread::get_id()
+              << std::endl;
+  };
+
+  {
+    auto [sn, rc] = make_channel<int>(3, overflow_policy::fail);
+    for (int i = 0; i < 5; ++i) {
+      log("send   ", sn.push(i) == push_status::success ? "success" : "full");
+    }
+    for (int i = 0; i < 3; ++i) {
+      log("receive", rc.next());
+    }
+  }
+
+  {
+    auto [sn, rc] = make_channel<int>(3, overflow_policy::drop_oldest);
+    for (int i = 0; i < 5; ++i) {
+      sn.push(i);
+    }
+    for (int i = 0; i < 3; ++i) {
+      log("receive", rc.next());
+    }
+  }
+
+  {
+    auto [sn, rc] = make_channel<int>(2);
+    sn.push(0);
+    log("try    ", sn.try_push(1) == push_status::success ? "success" : "full");
+    log("try    ", sn.try_push(2) == push_status::success ? "success" : "full");
+    log("timeout",
+        sn.push_for(3, 100ms) == push_status::success ? "success" : "full");
+    log("depth  ", sn.size());
+    rc.next();
+    rc.next();
+    log("depth  ", rc.size());
+    log("peak   ", sn.high_water());
+  }
+
+  {
+    auto [sn, rc] = make_channel<int>(with_single_sender, 4);
+    for (int i = 0; i < 4; ++i) {
+      sn.push(i);
+    }
+    sn.close();
+    log("push   ", sn.push(4) == push_status::closed ? "closed" : "not closed");
+    try {
+      while (true) {
+        log("drain  ", rc.next());
+      }
+    }
+    catch (const close_channel &) {
+      log("drain  ", "close");
+    }
+    log("peak   ", rc.high_water());
+  }
+  {
+    auto [sn, rc] = make_channel<int>(4);
+    for (int i = 0; i < 4; ++i) {
+      sn.push(i);
+    }
+    sn.abort();
+    log("abort  ", rc.try_next() ? "value" : "nothing");
+  }
+
+  auto [sn, rc] = make_channel<int>(3);
+
+  auto produce = [&log](auto sn) {
+    for (int i = 0; i < 10; ++i) {
+      log("send   ", i);
+      sn.push(i);
+    }
+    log("send   ", "close");
+    sn.close();
+  };
+
+  auto consume = [&log](auto rc) {
+    try {
+      while (true) {
+        std::this_thread::sleep_for(100ms);
+        log("receive", rc.next());
+      }
+    }
+    catch (const close_channel &) {
+      log("receive", "close");
+    }
+  };
+
+  std::thread producer{produce, std::move(sn)};
+  std::thread consumer{consume, std::move(rc)};
+  producer.join();
+  consumer.join();
+}
@@ -0,0 +1,75 @@
+#include "../ratatoskr/concurrent.hpp"
+#include <atomic>
+#include <forward_list>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+int main() {
+  using namespace rat::concurrent;
+
+  auto log = [](auto tag, auto x) {
+    static std::mutex io_mutex;
+    std::lock_guard lock{io_mutex};
+    std::cout << tag << ": " << x << " @thread #" << std::this_thread::get_id()
+              << std::endl;
+  };
+
+  auto [sn, rc] = make_channel<int>(with_shared_receiver, 8);
+  std::atomic<long> sum{0};
+  std::atomic<int> count{0};
+
+  auto produce = [](auto sn, int base) {
+    for (int i = 0; i < 1000; ++i) {
+      sn.push(base + i);
+    }
+  };
+
+  auto consume = [&log, &sum, &count](auto rc) {
+    try {
+      while (true) {
+        sum.fetch_add(rc.next(), std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    catch (const close_channel &) {
+      log("receive", "close");
+    }
+  };
+
+  std::forward_list<std::thread> consumers;
+  for (int i = 0; i < 4; ++i) {
+    consumers.emplace_front(consume, rc);
+  }
+  std::forward_list<std::thread> producers;
+  for (int i = 0; i < 4; ++i) {
+    producers.emplace_front(produce, sn, i * 1000);
+  }
+  for (auto &&p : producers) {
+    p.join();
+  }
+  sn.close();
+  for (auto &&c : consumers) {
+    c.join();
+  }
+
+  log("count  ", count.load());
+  log("sum    ", sum.load() == 4000L * 3999 / 2 ? "all values" : "lost values");
+
+  {
+    auto [sn, rc] = make_channel<int>(with_shared_receiver, 4,
+                                      overflow_policy::drop_oldest);
+    for (int i = 0; i < 8; ++i) {
+      sn.push(i);
+    }
+    sn.close();
+    try {
+      while (true) {
+        log("latest ", rc.next());
+      }
+    }
+    catch (const close_channel &) {
+      log("latest ", "close");
+    }
+  }
+}
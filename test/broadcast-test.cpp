@@ -0,0 +1,69 @@
+#include "../ratatoskr/concurrent.hpp"
+#include <chrono>
+#include <forward_list>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+int main() {
+  using namespace rat::concurrent;
+  using namespace std::chrono_literals;
+
+  auto log = [](auto tag, auto x) {
+    static std::mutex io_mutex;
+    std::lock_guard lock{io_mutex};
+    std::cout << tag << ": " << x << " @thread #" << std::this_thread::get_id()
+              << std::endl;
+  };
+
+  auto [sn, rc] = make_broadcast_channel<int>(4);
+
+  auto consume = [&log](auto rc) {
+    try {
+      while (true) {
+        log("receive", rc.next());
+      }
+    }
+    catch (const close_channel &) {
+      log("receive", "close");
+    }
+  };
+
+  std::forward_list<std::thread> consumers;
+  for (int i = 0; i < 2; ++i) {
+    consumers.emplace_front(consume, rc.subscribe());
+  }
+  consumers.emplace_front(consume, std::move(rc));
+
+  for (int i = 0; i < 5; ++i) {
+    log("send   ", i);
+    sn.push(i);
+    std::this_thread::sleep_for(100ms);
+  }
+  log("send   ", "close");
+  sn.close();
+
+  for (auto &&c : consumers) {
+    c.join();
+  }
+
+  auto [lossy_sn, lossy_rc] =
+      make_broadcast_channel<int>(4, overflow_policy::drop_oldest);
+  for (int i = 0; i < 10; ++i) {
+    lossy_sn.push(i);
+  }
+  while (auto x = lossy_rc.try_next()) {
+    log("receive", *x);
+  }
+  log("lagged ", lossy_rc.lagged());
+
+  auto [shared_sn, shared_rc] = make_broadcast_channel<std::string>(2);
+  auto other_rc = shared_rc.subscribe();
+  shared_sn.push("shared");
+  auto x = shared_rc.next_shared();
+  auto y = other_rc.try_next_shared();
+  log("shared ", *x);
+  log("shared ", x == y ? "same value" : "copied");
+  log("shared ", other_rc.try_next_shared() ? "value" : "empty");
+}
@@ -2,6 +2,7 @@
 #include <chrono>
 #include <iostream>
 #include <mutex>
+#include <string>
 #include <thread>
 
 int main() {
@@ -42,4 +43,65 @@ int main() {
   std::thread consumer{consume, std::move(rc)};
   producer.join();
   consumer.join();
+
+  {
+    auto [sn, rc] = make_channel<int>();
+    std::thread{[sn = std::move(sn)]() mutable {
+      for (int i = 0; i < 3; ++i) {
+        sn.push(i);
+      }
+    }}.join();
+    try {
+      while (true) {
+        log("last   ", rc.next());
+      }
+    }
+    catch (const close_channel &) {
+      log("last   ", "close");
+    }
+  }
+  {
+    auto [sn, rc] = make_channel<int>();
+    { auto dropped = std::move(rc); }
+    log("push   ", sn.push(0) == push_status::no_receiver ? "no receiver"
+                                                          : "received");
+  }
+  {
+    auto [sn, rc] = make_channel<int, std::string>();
+    std::thread{[sn = std::move(sn)]() mutable {
+      sn.push(1);
+      sn.push(std::string{"two"});
+      sn.push(3);
+    }}.join();
+    try {
+      while (true) {
+        rc.visit(overloaded{[&log](int x) { log("int    ", x); },
+                            [&log](const std::string &x) {
+                              log("string ", x);
+                            }});
+      }
+    }
+    catch (const close_channel &) {
+      log("visit  ", "close");
+    }
+  }
+  {
+    auto [sn, rc] = make_channel<int>();
+    rc.set_spin_count(1000);
+    std::thread producer{[sn = std::move(sn)]() mutable {
+      for (int i = 0; i < 3; ++i) {
+        sn.push(i);
+        std::this_thread::sleep_for(10us);
+      }
+    }};
+    try {
+      while (true) {
+        log("spin   ", rc.next());
+      }
+    }
+    catch (const close_channel &) {
+      log("spin   ", "close");
+    }
+    producer.join();
+  }
 }
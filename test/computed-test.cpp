@@ -0,0 +1,42 @@
+#include "../ratatoskr/signal.hpp"
+#include <iostream>
+
+int main() {
+  int evaluations = 0;
+
+  rat::value<int> a{1};
+  auto twice = rat::combine(a, [&evaluations](int x) {
+    ++evaluations;
+    return x * 2;
+  });
+  auto next = rat::combine(a, [&evaluations](int x) {
+    ++evaluations;
+    return x + 1;
+  });
+  auto sum = rat::combine(twice, next, [&evaluations](int x, int y) {
+    ++evaluations;
+    return x + y;
+  });
+  auto parity = rat::combine(a, [](int x) { return x % 2; });
+
+  std::cout << "sum: " << sum.get() << ", evaluations: " << evaluations
+            << std::endl;
+
+  a.set(2);
+  std::cout << "set 2, evaluations: " << evaluations << std::endl;
+  std::cout << "sum: " << sum.get() << ", evaluations: " << evaluations
+            << std::endl;
+
+  sum.observe([](int x) { std::cout << "sum changed: " << x << std::endl; });
+  parity.observe(
+      [](int x) { std::cout << "parity changed: " << x << std::endl; });
+
+  a.set(4);
+  a.set(5);
+
+  rat::batch([&a] {
+    a.set(10);
+    a.set(11);
+  });
+  std::cout << "evaluations: " << evaluations << std::endl;
+}
@@ -0,0 +1,58 @@
+#include "../ratatoskr/concurrent.hpp"
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+using namespace rat::concurrent;
+
+template <class Log>
+async_task consumer(int id, shared_receiver<int> rc, std::atomic<int> &count,
+                    Log log) {
+  while (true) {
+    int x = co_await rc.async_next();
+    log("receive #" + std::to_string(id), x);
+    ++count;
+  }
+}
+
+template <class Log>
+async_task producer(sender<int> sn, Log log) {
+  for (int i = 0; i < 10; ++i) {
+    log("send      ", i);
+    if (co_await sn.async_push(i) != push_status::success) {
+      break;
+    }
+  }
+}
+
+int main() {
+  auto log = [](auto tag, auto x) {
+    static std::mutex io_mutex;
+    std::lock_guard lock{io_mutex};
+    std::cout << tag << ": " << x << " @thread #" << std::this_thread::get_id()
+              << std::endl;
+  };
+
+  scheduler sched{2};
+  auto [sn, rc] = make_channel<int>(2);
+  auto closer = rc.get_closer();
+  auto shared = std::move(rc).share();
+  std::atomic<int> count{0};
+  for (int i = 0; i < 3; ++i) {
+    sched.spawn(consumer(i, shared, count, log), closer);
+  }
+  sched.spawn(producer(std::move(sn), log));
+  while (count < 10) {
+    std::this_thread::yield();
+  }
+
+  sched.halt();
+  sched.wait();
+  log("halt      ", "done");
+}
+#else
+int main() { std::cout << "coroutines are not supported" << std::endl; }
+#endif
@@ -0,0 +1,62 @@
+#include "../ratatoskr/concurrent.hpp"
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct frame {
+  int id;
+  std::string payload;
+};
+
+int main() {
+  using namespace rat::concurrent;
+
+  auto log = [](auto tag, auto x) {
+    static std::mutex io_mutex;
+    std::lock_guard lock{io_mutex};
+    std::cout << tag << ": " << x << " @thread #" << std::this_thread::get_id()
+              << std::endl;
+  };
+
+  auto pass = [&log](auto name, auto sn, auto rc) {
+    std::thread producer{[sn = std::move(sn)]() mutable {
+      for (int i = 0; i < 3; ++i) {
+        sn.push(std::make_unique<frame>(frame{i, "frame"}));
+      }
+      sn.emplace(new frame{3, "emplaced"});
+    }};
+    for (int i = 0; i < 2; ++i) {
+      auto f = rc.next();
+      log(name, f->payload + " " + std::to_string(f->id));
+    }
+    producer.join();
+    std::vector<std::unique_ptr<frame>> rest;
+    rc.next_n(std::back_inserter(rest), 1);
+    rc.try_drain(rest);
+    for (auto &&f : rest) {
+      log(name, f->payload + " " + std::to_string(f->id));
+    }
+  };
+
+  {
+    auto [sn, rc] = make_channel<std::unique_ptr<frame>>();
+    pass("mutex  ", std::move(sn), std::move(rc));
+  }
+  {
+    auto [sn, rc] = make_channel<std::unique_ptr<frame>>(2);
+    pass("bounded", std::move(sn), std::move(rc));
+  }
+  {
+    auto [sn, rc] = make_channel<std::unique_ptr<frame>>(with_single_sender, 2);
+    pass("spsc   ", std::move(sn), std::move(rc));
+  }
+  {
+    auto [sn, rc] =
+        make_channel<std::unique_ptr<frame>>(with_shared_receiver, 2);
+    pass("mpmc   ", std::move(sn), std::move(rc));
+  }
+}
@@ -0,0 +1,116 @@
+#include "../ratatoskr/concurrent.hpp"
+#include "../ratatoskr/functional.hpp"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+int main() {
+  using namespace rat;
+  using namespace std::chrono_literals;
+
+  auto log = [](auto tag, auto x) {
+    static std::mutex io_mutex;
+    std::lock_guard lock{io_mutex};
+    std::cout << tag << ": " << x << " @thread #" << std::this_thread::get_id()
+              << std::endl;
+  };
+
+  scheduler sched{2};
+
+  auto [sn, rc] = make_channel<int>();
+  auto [sn2, rc2] = make_channel<double>();
+
+  sched.connect(std::move(rc) |
+                thunk{}.filter([](auto n) { return n % 2 == 0; }) |
+                thunk{}.map([](auto n) { return n * 0.5; }) | std::move(sn2));
+  sched.connect(std::move(rc2), [&log](double x) { log("receive", x); });
+
+  for (int i = 0; i < 10; ++i) {
+    log("send   ", i);
+    sn.push(i);
+    std::this_thread::sleep_for(100ms);
+  }
+
+  sn.close();
+  sched.halt();
+  sched.wait();
+  log("halt   ", "done");
+
+  {
+    scheduler sched{2};
+    auto [sn, rc] = make_channel<int>();
+    auto [sn2, rc2] = make_channel<int>();
+    sched.connect(std::move(rc) |
+                  thunk{}.fold(0, [](int a, int n) { return a + n; }) |
+                  std::move(sn2));
+    for (int i = 0; i < 10; ++i) {
+      sn.push(i);
+    }
+    sn.close();
+    log("fold   ", rc2.next());
+    sched.halt();
+    sched.wait();
+  }
+  {
+    scheduler sched{1};
+    auto [sn, rc] = make_channel<int>();
+    auto [sn2, rc2] = make_channel<int>(1);
+    for (int i = 0; i < 100; ++i) {
+      sn.push(i);
+    }
+    sn.close();
+    std::atomic<int> received{0};
+    std::promise<void> done;
+    sched.connect(std::move(rc) | thunk{}.map([](int n) { return n; }) |
+                  std::move(sn2));
+    sched.connect(std::move(rc2), [&received, &done](int) {
+      if (++received == 100) {
+        done.set_value();
+      }
+    });
+    done.get_future().wait_for(10s);
+    log("bounded", received.load());
+    sched.halt();
+    sched.wait();
+  }
+  {
+    scheduler sched{1};
+    auto [sn, rc] = make_channel<int>();
+    auto [sn2, rc2] = make_channel<int>();
+    { auto dropped = std::move(rc2); }
+    sched.connect(std::move(rc) | thunk{}.map([](int n) { return n; }) |
+                  std::move(sn2));
+    auto status = push_status::success;
+    for (int i = 0; i < 100 && status == push_status::success; ++i) {
+      status = sn.push(i);
+      std::this_thread::sleep_for(10ms);
+    }
+    log("dropped", status == push_status::success ? "running" : "stopped");
+    sched.halt();
+    sched.wait();
+  }
+  {
+    scheduler sched{1};
+    auto [sn, rc] = make_channel<std::unique_ptr<int>>();
+    auto [sn2, rc2] = make_channel<std::unique_ptr<int>>(1);
+    sched.connect(std::move(rc) | thunk{}.map([](std::unique_ptr<int> p) {
+      *p *= 2;
+      return p;
+    }) | std::move(sn2));
+    for (int i = 0; i < 10; ++i) {
+      sn.push(std::make_unique<int>(i));
+    }
+    sn.close();
+    int sum = 0;
+    for (int i = 0; i < 10; ++i) {
+      sum += *rc2.next();
+    }
+    log("move   ", sum);
+    sched.halt();
+    sched.wait();
+  }
+}
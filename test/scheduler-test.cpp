@@ -0,0 +1,80 @@
+#include "../ratatoskr/concurrent.hpp"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+int main() {
+  using namespace rat::concurrent;
+  using namespace std::chrono_literals;
+
+  auto log = [](auto tag, auto x) {
+    static std::mutex io_mutex;
+    std::lock_guard lock{io_mutex};
+    std::cout << tag << ": " << x << " @thread #" << std::this_thread::get_id()
+              << std::endl;
+  };
+
+  scheduler sched{2};
+
+  auto [sn, rc] = make_channel<int>();
+  auto [sn2, rc2] = make_channel<int>(with_shared_receiver);
+
+  sched.connect(std::move(rc), [&log, sn2 = sn2](int x) mutable {
+    log("double ", x);
+    sn2.push(x * 2);
+  });
+  for (int i = 0; i < 3; ++i) {
+    sched.connect(rc2, [&log](int x) { log("receive", x); });
+  }
+
+  auto produce = [&log](auto sn) {
+    for (int i = 0; i < 10; ++i) {
+      log("send   ", i);
+      sn.push(i);
+      std::this_thread::sleep_for(100ms);
+    }
+  };
+
+  std::thread producer{produce, std::move(sn)};
+  producer.join();
+
+  sched.halt();
+  sched.wait();
+  log("halt   ", "done");
+
+  {
+    scheduler pinned{2, cpu_set::of_node(0)};
+    auto [sn, rc] = make_channel<int>();
+    pinned.connect(std::move(rc), [&log](int x) { log("pinned ", x); });
+    for (int i = 0; i < 3; ++i) {
+      sn.push(i);
+    }
+    sn.close();
+    std::this_thread::sleep_for(100ms);
+    pinned.halt();
+    pinned.wait();
+  }
+  {
+    scheduler fair{1};
+    auto [sn, rc] = make_channel<int>();
+    auto [sn2, rc2] = make_channel<int>();
+    for (int i = 0; i < 100000; ++i) {
+      sn.push(i);
+    }
+    sn2.push(0);
+    std::atomic<int> busy{0};
+    std::promise<void> done;
+    fair.connect(std::move(rc), [&busy](int) { ++busy; });
+    fair.connect(std::move(rc2), [&log, &busy, &done](int) {
+      log("ready  ",
+          busy < 100000 ? "before the backlog" : "after the backlog");
+      done.set_value();
+    });
+    done.get_future().wait();
+    fair.halt();
+    fair.wait();
+  }
+}
@@ -0,0 +1,70 @@
+#include "../ratatoskr/concurrent.hpp"
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+int main() {
+  using namespace rat::concurrent;
+  using namespace std::chrono_literals;
+
+  auto log = [](auto tag, auto x) {
+    static std::mutex io_mutex;
+    std::lock_guard lock{io_mutex};
+    std::cout << tag << ": " << x << " @thread #" << std::this_thread::get_id()
+              << std::endl;
+  };
+
+  auto [numbers, number_rc] = make_channel<int>();
+  auto [words, word_rc] = make_channel<std::string>(with_shared_receiver);
+
+  std::thread producer{[&log, numbers = std::move(numbers),
+                        words = std::move(words)]() mutable {
+    for (int i = 0; i < 5; ++i) {
+      log("send   ", i);
+      numbers.push(i);
+      std::this_thread::sleep_for(50ms);
+      log("send   ", "word " + std::to_string(i));
+      words.push("word " + std::to_string(i));
+      std::this_thread::sleep_for(50ms);
+    }
+    numbers.close();
+    words.close();
+  }};
+
+  try {
+    while (true) {
+      auto v = select(number_rc, word_rc);
+      if (v.index() == 0) {
+        log("number ", std::get<0>(v));
+      }
+      else {
+        log("word   ", std::get<1>(v));
+      }
+    }
+  }
+  catch (const close_channel &) {
+    log("receive", "close");
+  }
+  producer.join();
+
+  auto [sn, rc] = make_channel<int>();
+  log("timeout", select_for(10ms, rc).has_value() ? "no" : "yes");
+
+  int closed = 0;
+  for (int i = 0; i < 20000; ++i) {
+    auto [sn, rc] = make_channel<int>();
+    auto [sn2, rc2] = make_channel<int>();
+    sn2.close();
+    std::thread closer{[sn = std::move(sn)]() mutable { sn.close(); }};
+    try {
+      select(rc, rc2);
+    }
+    catch (const close_channel &) {
+      ++closed;
+    }
+    closer.join();
+  }
+  log("closed ", closed);
+}
@@ -0,0 +1,59 @@
+#include "../ratatoskr/shm.hpp"
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+struct point {
+  int x;
+  int y;
+};
+
+int main() {
+  using namespace rat::concurrent;
+
+  auto log = [](auto tag, auto x) {
+    static std::mutex io_mutex;
+    std::lock_guard lock{io_mutex};
+    std::cout << tag << ": " << x << " @process #" << getpid() << std::endl;
+  };
+
+  auto name = "/ratatoskr-shm-test-" + std::to_string(getpid());
+  shm_channel<point> ch{name, 4};
+  auto sn = ch.get_sender();
+
+  auto pid = fork();
+  if (pid == 0) {
+    {
+      shm_channel<point> opened{name};
+      try {
+        opened.get_sender();
+      }
+      catch (const sender_already_retrived &) {
+        log("sender ", "already retrived");
+      }
+      auto rc = opened.get_receiver();
+      try {
+        while (true) {
+          auto p = rc.next();
+          log("receive", p.x + p.y);
+        }
+      }
+      catch (const close_channel &) {
+        log("receive", "close");
+      }
+    }
+    _exit(0);
+  }
+
+  for (int i = 0; i < 10; ++i) {
+    log("send   ", i * 3);
+    sn.push(point{i, i * 2});
+  }
+  log("send   ", "close");
+  sn.close();
+  int status;
+  waitpid(pid, &status, 0);
+  log("child  ", WEXITSTATUS(status));
+}
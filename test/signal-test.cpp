@@ -0,0 +1,39 @@
+#include "../ratatoskr/functional.hpp"
+#include "../ratatoskr/signal.hpp"
+#include <iostream>
+
+int main() {
+  rat::signal<int> sig;
+
+  auto c1 =
+      sig.connect([](int x) { std::cout << "slot 1: " << x << std::endl; });
+
+  rat::connection c2;
+  c2 = sig.connect([&sig, &c2](int x) {
+    std::cout << "slot 2: " << x << ", disconnect itself" << std::endl;
+    c2.disconnect();
+    sig.connect([](int y) { std::cout << "slot 3: " << y << std::endl; });
+  });
+
+  sig.connect(rat::thunk{}
+                  .filter([](auto n) { return n % 2 == 0; })
+                  .map([](auto n) { return n * 10; }),
+              [](int y) { std::cout << "thunk:  " << y << std::endl; });
+
+  for (int i = 0; i < 3; ++i) {
+    sig.emit(i);
+  }
+
+  {
+    rat::scoped_connection scoped = sig.connect(
+        [](int x) { std::cout << "scoped: " << x << std::endl; });
+    sig(3);
+  }
+
+  c1.disconnect();
+  sig(4);
+
+  std::cout << "connections: " << sig.size() << std::endl;
+  std::cout << "c1: " << (c1.connected() ? "connected" : "disconnected")
+            << std::endl;
+}
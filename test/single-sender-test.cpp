@@ -0,0 +1,80 @@
+#include "../ratatoskr/concurrent.hpp"
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+int main() {
+  using namespace rat::concurrent;
+  using namespace std::chrono_literals;
+
+  auto log = [](auto tag, auto x) {
+    static std::mutex io_mutex;
+    std::lock_guard lock{io_mutex};
+    std::cout << tag << ": " << x << " @thread #" << std::this_thread::get_id()
+              << std::endl;
+  };
+
+  auto [sn, rc] = make_channel<int>(with_single_sender, 4);
+  static_assert(!std::is_copy_constructible_v<decltype(sn)>);
+  static_assert(!std::is_copy_assignable_v<decltype(sn)>);
+  static_assert(std::is_move_constructible_v<decltype(sn)>);
+  static_assert(std::is_copy_constructible_v<sender<int, channel_state<int>>>);
+
+  auto produce = [&log](auto sn) {
+    for (int i = 0; i < 10; ++i) {
+      log("send   ", i);
+      sn.push(i);
+      std::this_thread::sleep_for(100ms);
+    }
+    log("send   ", "close");
+    sn.close();
+  };
+
+  auto consume = [&log](auto rc) {
+    try {
+      while (true) {
+        log("receive", rc.next());
+      }
+    }
+    catch (const close_channel &) {
+      log("receive", "close");
+    }
+  };
+
+  std::thread producer{produce, std::move(sn)};
+  std::thread consumer{consume, std::move(rc)};
+  producer.join();
+  consumer.join();
+
+  {
+    channel<int, spsc_channel_state<int>> ch{8};
+    auto sn = ch.get_sender();
+    try {
+      ch.get_sender();
+    }
+    catch (const sender_already_retrived &) {
+      log("sender ", "already retrived");
+    }
+  }
+  {
+    auto [sn, rc] = make_channel<int>(with_single_sender, 4);
+    rc.set_spin_count(1000);
+    std::thread producer{[sn = std::move(sn)]() mutable {
+      for (int i = 0; i < 3; ++i) {
+        sn.push(i);
+        std::this_thread::sleep_for(10us);
+      }
+    }};
+    try {
+      while (true) {
+        log("spin   ", rc.next());
+      }
+    }
+    catch (const close_channel &) {
+      log("spin   ", "close");
+    }
+    producer.join();
+  }
+}
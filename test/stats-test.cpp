@@ -0,0 +1,71 @@
+#define RATATOSKR_CHANNEL_STATS
+#include "../ratatoskr/concurrent.hpp"
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+int main() {
+  using namespace rat::concurrent;
+  using namespace std::chrono_literals;
+
+  auto log = [](auto tag, auto x) {
+    static std::mutex io_mutex;
+    std::lock_guard lock{io_mutex};
+    std::cout << tag << ": " << x << " @thread #" << std::this_thread::get_id()
+              << std::endl;
+  };
+
+  auto print = [&log](const channel_stats &s) {
+    log("pushes     ", s.pushes);
+    log("pops       ", s.pops);
+    log("depth      ", s.depth);
+    log("high water ", s.high_water);
+    log("blocked ms ",
+        std::chrono::duration_cast<std::chrono::milliseconds>(s.blocked)
+            .count());
+    log("contentions", s.contentions);
+  };
+
+  {
+    auto [sn, rc] = make_channel<int>(8);
+    std::thread consumer{[rc = std::move(rc)]() mutable {
+      try {
+        while (true) {
+          rc.next();
+        }
+      }
+      catch (const close_channel &) {
+      }
+    }};
+    std::this_thread::sleep_for(100ms);
+    for (int i = 0; i < 100; ++i) {
+      sn.push(i);
+    }
+    auto s = sn.stats();
+    sn.close();
+    consumer.join();
+    print(s);
+  }
+  {
+    auto [sn, rc] = make_channel<int>(with_single_sender, 8);
+    for (int i = 0; i < 5; ++i) {
+      sn.push(i);
+    }
+    rc.next();
+    print(rc.stats());
+  }
+
+  scheduler sched{2};
+  auto [sn, rc] = make_channel<int>();
+  sched.connect(std::move(rc), [](int) {});
+  for (int i = 0; i < 100; ++i) {
+    sn.push(i);
+  }
+  std::this_thread::sleep_for(100ms);
+  auto s = sched.stats();
+  log("stages     ", s.running_stages);
+  log("processed  ", s.processed);
+  sched.halt();
+  sched.wait();
+}
@@ -0,0 +1,104 @@
+#include "../ratatoskr/concurrent.hpp"
+#include "../ratatoskr/functional.hpp"
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+constexpr int half_of_even(int n) {
+  auto f = rat::thunk{}
+               .filter([](int n) { return n % 2 == 0; })
+               .map([](int n) { return n / 2; });
+  auto x = f(n);
+  return x ? *x : -1;
+}
+
+static_assert(half_of_even(10) == 5 && half_of_even(11) == -1);
+
+int main() {
+  auto even = [](auto n) { return n % 2 == 0; };
+
+  auto f = rat::thunk{}
+               .filter(even)
+               .map([](auto n) {
+                 std::cout << "map: " << n << std::endl;
+                 return n;
+               })
+               .map([](auto n) { return n / 2; })
+               .filter([](auto n) { return n > 5; });
+
+  for (int i = 10; i < 13; ++i) {
+    if (auto x = f(i)) {
+      std::cout << "optional: " << *x << std::endl;
+    }
+    else {
+      std::cout << "optional: nullopt" << std::endl;
+    }
+  }
+
+  std::vector<int> out;
+  for (int i = 0; i < 30; ++i) {
+    f(i, [&out](auto x) { out.push_back(x); });
+  }
+  for (auto &&x : out) {
+    std::cout << "sink: " << x << std::endl;
+  }
+
+  std::vector<int> in(30);
+  for (int i = 0; i < 30; ++i) {
+    in[i] = i;
+  }
+  auto g = rat::thunk{}.filter(even).map([](auto n) { return n * 1.5; });
+  for (auto &&x : rat::transform_filter(g, in)) {
+    std::cout << "transform_filter: " << x << std::endl;
+  }
+
+  std::vector<long> large(1000000);
+  for (std::size_t i = 0; i < large.size(); ++i) {
+    large[i] = static_cast<long>(i);
+  }
+  auto h = rat::thunk{}
+               .filter([](auto n) { return n % 7 == 0; })
+               .map([](auto n) { return n * 3; });
+  rat::thread_pool pool{4};
+  auto sequential = rat::transform_filter(h, large);
+  auto parallel = rat::transform_filter(pool, h, large);
+  std::cout << "parallel: " << parallel.size() << " values, "
+            << (sequential == parallel ? "same" : "different") << " order"
+            << std::endl;
+
+  auto sum = [](auto a, auto n) { return a + n; };
+  auto print = [](auto tag) {
+    return [tag](auto x) { std::cout << tag << ": " << x << std::endl; };
+  };
+  auto s = rat::thunk{}.skip(2).take(4).scan(0, sum);
+  for (int i = 0; i < 10; ++i) {
+    s(i, print("scan"));
+  }
+  auto c = rat::thunk{}.chunk(3, 0, sum);
+  for (int i = 0; i < 8; ++i) {
+    c(i, print("chunk"));
+  }
+  c.flush(print("chunk"));
+  auto b = rat::thunk{}.chunk<int>(4);
+  for (int i = 0; i < 6; ++i) {
+    b(i, [](const std::vector<int> &v) {
+      std::cout << "batch: " << v.size() << std::endl;
+    });
+  }
+  b.flush([](const std::vector<int> &v) {
+    std::cout << "batch: " << v.size() << std::endl;
+  });
+
+  std::vector<int> total;
+  rat::thunk{}.fold(0, sum).apply(in, std::back_inserter(total));
+  std::cout << "apply fold: " << total.at(0) << std::endl;
+  auto tail = rat::transform_filter(rat::thunk{}.chunk(4, 0, sum), in);
+  std::cout << "chunk tail: " << tail.size() << " sums, last "
+            << tail.back() << std::endl;
+  auto k = rat::thunk{}.skip(1).chunk(1000, 0L, sum);
+  auto sequential_sums = rat::transform_filter(k, large);
+  auto parallel_sums = rat::transform_filter(pool, k, large);
+  std::cout << "parallel chunk: " << parallel_sums.size() << " sums, "
+            << (sequential_sums == parallel_sums ? "same" : "different")
+            << std::endl;
+}
@@ -0,0 +1,58 @@
+#include "../ratatoskr/concurrent.hpp"
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+int main() {
+  using namespace rat::concurrent;
+  using namespace std::chrono_literals;
+
+  auto log = [](auto tag, auto x) {
+    static std::mutex io_mutex;
+    std::lock_guard lock{io_mutex};
+    std::cout << tag << ": " << x << " @thread #" << std::this_thread::get_id()
+              << std::endl;
+  };
+
+  auto timed = [&log](auto name, auto sn, auto rc) {
+    log(name, rc.try_next() ? "value" : "empty");
+    sn.push(1);
+    log(name, *rc.try_next());
+
+    auto start = std::chrono::steady_clock::now();
+    log(name, rc.next_for(100ms) ? "value" : "timeout");
+    log(name, std::chrono::steady_clock::now() - start >= 100ms ? "waited"
+                                                                : "early");
+    log(name, rc.next_until(std::chrono::steady_clock::now() + 10ms)
+                  ? "value"
+                  : "timeout");
+
+    sn.push(2);
+    log(name, *rc.next_for(100ms));
+
+    std::thread closer{[sn = std::move(sn)]() mutable {
+      std::this_thread::sleep_for(100ms);
+      sn.close();
+    }};
+    start = std::chrono::steady_clock::now();
+    log(name, rc.next_for(10s) ? "value" : "nothing");
+    log(name, std::chrono::steady_clock::now() - start < 10s ? "woken"
+                                                             : "timed out");
+    log(name, rc.closed() ? "closed" : "open");
+    closer.join();
+  };
+
+  {
+    auto [sn, rc] = make_channel<int>();
+    timed("mutex  ", std::move(sn), std::move(rc));
+  }
+  {
+    auto [sn, rc] = make_channel<int>(with_single_sender, 4);
+    timed("spsc   ", std::move(sn), std::move(rc));
+  }
+  {
+    auto [sn, rc] = make_channel<int>(with_shared_receiver, 4);
+    timed("mpmc   ", std::move(sn), std::move(rc));
+  }
+}